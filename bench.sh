@@ -0,0 +1,73 @@
+#!/bin/bash
+# Runs the headless bench scenarios and compares them with a baseline.
+# Usage: ./bench.sh BINARY BASELINE TOLERANCE OUTPUT [--update] SCENARIO...
+# A metric regresses when it exceeds the baseline by more than TOLERANCE (0.2 is
+# 20%), allocations per tick may also not grow from zero. --update rewrites the
+# baseline with this run instead of comparing
+binary=$1
+baseline=$2
+tolerance=$3
+output=$4
+shift 4
+update=0
+if [ "$1" == "--update" ]; then
+    update=1
+    shift
+fi
+
+lines=()
+for scenario in "$@"; do
+    line=$("$binary" --bench "$scenario" 2>/dev/null) || exit 1
+    echo "$line" >&2
+    lines+=("$line")
+done
+{
+    echo "["
+    for ((i = 0; i < ${#lines[@]}; ++i)); do
+        if ((i + 1 < ${#lines[@]})); then echo "  ${lines[i]},"; else echo "  ${lines[i]}"; fi
+    done
+    echo "]"
+} > "$output"
+
+if [ $update == 1 ]; then
+    cp "$output" "$baseline"
+    echo "bench: baseline updated: $baseline"
+    exit 0
+fi
+
+# one scenario object per line in both files
+awk -v tolerance="$tolerance" '
+function field(line, key,    n) {
+    if (!match(line, "\"" key "\":[^,}]*")) return ""
+    n = length(key) + 3
+    return substr(line, RSTART + n, RLENGTH - n)
+}
+function check(scenario, key, value, base) {
+    if (value == "" || value == "null" || base == "" || base == "null") return
+    if (value + 0 > base * (1.0 + tolerance) + (key == "allocs_per_tick" ? 0.0001 : 0)) {
+        gsub("\"", "", scenario)
+        printf "bench: %s %s regressed: %s (baseline %s)\n", scenario, key, value, base
+        n_regressions += 1
+    }
+}
+FNR == NR {
+    name = field($0, "scenario")
+    if (name != "") base[name] = $0
+    next
+}
+{
+    name = field($0, "scenario")
+    if (name == "") next
+    if (!(name in base)) {
+        printf "bench: %s has no baseline\n", substr(name, 2, length(name) - 2)
+        next
+    }
+    n_keys = split("ns_per_tick allocs_per_tick peak_rss_kb", keys, " ")
+    for (i = 1; i <= n_keys; ++i) {
+        check(name, keys[i], field($0, keys[i]), field(base[name], keys[i]))
+    }
+}
+END {
+    if (n_regressions > 0) exit 1
+    print "bench: no regressions"
+}' "$baseline" "$output"
@@ -0,0 +1,54 @@
+#include "../src/assets.h"
+#include "../src/pack.h"
+#include "raylib.h"
+#include <stdio.h>
+#include <string.h>
+
+// Packs ./resources into a single archive, paths in the pack are the same as
+// the game uses for the loose files. Run it from the repository root. The
+// directories after the output keep only their files (the web build splits the
+// resources into a preloaded pack and a lazily fetched one)
+static Assets ASSETS;
+
+static bool is_in_dirs(const char *file_path, int n_dirs, char **dirs);
+
+int main(int argc, char **argv) {
+    const char *file_path = argc >= 2 ? argv[1] : "./resources.pack";
+    if (argc >= 2 && argv[1][0] == '-') {
+        printf("Usage: %s [OUTPUT [DIR...]]\n", argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+    scan_assets(&ASSETS, "./resources");
+
+    // the manifest stays sorted by the file path
+    int n_dirs = argc > 2 ? argc - 2 : 0;
+    if (n_dirs > 0) {
+        int n = 0;
+        for (int i = 0; i < ASSETS.n; ++i) {
+            if (is_in_dirs(ASSETS.assets[i].file_path, n_dirs, argv + 2)) {
+                ASSETS.assets[n++] = ASSETS.assets[i];
+            }
+        }
+        ASSETS.n = n;
+    }
+    if (!write_pack(&ASSETS, file_path)) return 1;
+
+    long size = 0;
+    for (int i = 0; i < ASSETS.n; ++i) {
+        size += ASSETS.assets[i].file_size;
+    }
+    printf("packed %d files (%ld bytes) into %s\n", ASSETS.n, size, file_path);
+
+    return 0;
+}
+
+static bool is_in_dirs(const char *file_path, int n_dirs, char **dirs) {
+    for (int i = 0; i < n_dirs; ++i) {
+        char prefix[MAX_ASSET_PATH_LEN];
+        snprintf(prefix, sizeof(prefix), "./resources/%s/", dirs[i]);
+        if (strncmp(file_path, prefix, strlen(prefix)) == 0) return true;
+    }
+    return false;
+}
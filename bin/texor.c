@@ -1,10 +1,27 @@
+#if defined(ALLOC_COUNT)
+#include "../src/alloc_count.h"
+#endif
+#include "../src/assets.h"
+#include "../src/atlas.h"
+#include "../src/audio.h"
+#include "../src/grid.h"
+#include "../src/ground.h"
+#include "../src/matcher.h"
+#include "../src/mixer.h"
+#include "../src/pack.h"
+#include "../src/profiler.h"
+#include "../src/replay.h"
+#include "../src/rng.h"
 #include "../src/shader.h"
+#include "../src/sprite_batch.h"
+#include "../src/text_cache.h"
+#include "../src/voices.h"
+#include "../src/words.h"
 #include "raylib.h"
 #include "raymath.h"
 #include "rcamera.h"
 #include "rlgl.h"
 #include <ctype.h>
-#include <dirent.h>
 #include <float.h>
 #include <math.h>
 #include <stdio.h>
@@ -14,6 +31,11 @@
 
 #if defined(PLATFORM_WEB)
 #include <emscripten/emscripten.h>
+#else
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <unistd.h>
 #endif
 
 #define min(a, b) (((a) < (b)) ? (a) : (b))
@@ -24,9 +46,13 @@
 #define SCREEN_WIDTH 1024
 #define SCREEN_HEIGHT 768
 
+#define PACK_FILE_PATH "./resources.pack"
+#define LAZY_PACK_URL "lazy.pack"  // web: audio, next to the page
+#define MAX_N_LAZY_PACK_FETCHES 3  // web: the game goes on silent after them
+
 #define MAX_N_ENEMIES 5
+#define MAX_N_HORDE_ENEMIES 10000
 #define MAX_WORD_LEN 32
-#define MAX_N_ENEMY_NAMES 20000
 #define MAX_N_ENEMY_EFFECTS 16
 
 // sound
@@ -40,6 +66,10 @@
 
 // shot
 #define SHOT_TRACE_DURATION 0.08
+#define MAX_N_SHOTS 16  // traces on the screen at once
+
+// events of one tick, a power of two: one per enemy at most, and a few more
+#define MAX_N_EVENTS 16384
 
 // drop
 #define MAX_N_DROPS 4
@@ -51,10 +81,16 @@
 #define SPAWN_RADIUS 35.0
 #define ENEMY_RADIUS 2.0
 #define PLAYER_RADIUS 2.0
+#define ENEMY_GRID_CELL_SIZE (2.0 * ENEMY_RADIUS)
+#define MIN_N_SORTED_ENEMIES 64  // see separate_enemies
+#define ENEMY_TARGET(i) (i)  // matcher target ids of the enemies and commands
+#define COMMAND_TARGET(i) (MAX_N_HORDE_ENEMIES + (i))
 #define BASE_SPAWN_PERIOD 5.0
 #define BASE_ENEMY_SPEED_FACTOR 0.3
 #define MAX_ENEMY_SPEED_FACTOR 1.1
 #define BOSS_SPAWN_PERIOD 10  // in number of enemies
+#define ENEMY_ATTACK_STRENGTH 10.0
+#define ENEMY_ATTACK_COOLDOWN 1.0
 #define PLAYER_SPEED 20.0
 #define PLAYER_MAX_HEALTH 100.0
 #define BACKSPACE_DAMAGE 1.0
@@ -66,6 +102,10 @@
 #define DIFFICULTY_HARD 6
 #define DIFFICULTY_MONKEYTYPE 12
 
+// horde
+#define HORDE_SPAWN_PERIOD 1.0
+#define HORDE_SPAWN_BATCH 250
+
 // puase
 #define PAUSE_COOLDOWN 5.0
 // cryonics
@@ -80,6 +120,40 @@
 #define DECAY_COOLDOWN 20.0
 #define DECAY_STRENGTH 0.5
 
+// simulation loop
+#define SIM_TICK_RATE 120
+#define MAX_FRAME_TIME 0.25
+#define MAX_N_PENDING_CHARS 16
+
+// headless
+#define HEADLESS_N_TICKS 72000
+#define BOT_CPM 250.0
+
+// batch
+#define MAX_N_BATCH_WORKERS 64
+#define MAX_N_SWEEP_VALUES 16
+
+// profiler
+#define PROFILE_TRACE_FILE_PATH "./profile_trace.json"
+
+// loading: groups of resources uploaded after the first frame, see update_loading
+#define RESOURCE_NAMES (1u << 0)
+#define RESOURCE_MODELS (1u << 1)
+#define RESOURCE_SPRITES (1u << 2)
+#define RESOURCE_AUDIO (1u << 3)
+#define RESOURCES_GAMEPLAY (RESOURCE_NAMES | RESOURCE_MODELS | RESOURCE_SPRITES)
+#define RESOURCES_ALL (RESOURCES_GAMEPLAY | RESOURCE_AUDIO)
+#define LOADING_DECODE_BUDGET 0.008  // s per frame, when the main thread decodes
+
+#if defined(PLATFORM_WEB)
+typedef enum LazyPackState {
+    LAZY_PACK_NONE = 0,
+    LAZY_PACK_FETCHING,
+    LAZY_PACK_OPEN,
+    LAZY_PACK_FAILED,
+} LazyPackState;
+#endif
+
 #define UI_BACKGROUND_COLOR ((Color){20, 20, 20, 255})
 #define UI_OUTLINE_COLOR ((Color){0, 40, 0, 255})
 
@@ -90,6 +164,50 @@ typedef struct Shot {
     Vector3 end_position;
 } Shot;
 
+// Timed phases of update_world and draw_world, see PROFILE_ZONE_NAMES
+typedef enum ProfileZone {
+    ZONE_UPDATE_PROMPT,
+    ZONE_UPDATE_COMMANDS,
+    ZONE_UPDATE_SPAWN,
+    ZONE_UPDATE_ENEMIES,
+    ZONE_UPDATE_ORDER,
+    ZONE_UPDATE_DROPS,
+    ZONE_UPDATE_PLAYER,
+    ZONE_MUSIC,
+    ZONE_LOADING,
+    ZONE_DRAW_GROUND_BAKE,
+    ZONE_DRAW_ARENA,
+    ZONE_DRAW_DROPS,
+    ZONE_DRAW_SPRITES,
+    ZONE_DRAW_LABELS,
+    ZONE_DRAW_PANE,
+    ZONE_DRAW_COMMANDS,
+    ZONE_DRAW_PROMPT,
+    ZONE_PRESENT,
+    N_PROFILE_ZONES,
+} ProfileZone;
+
+static const char *PROFILE_ZONE_NAMES[N_PROFILE_ZONES] = {
+    "update prompt",
+    "update commands",
+    "update spawn",
+    "update enemies",
+    "update order",
+    "update drops",
+    "update player",
+    "music",
+    "loading",
+    "draw ground bake",
+    "draw arena",
+    "draw drops",
+    "draw sprites",
+    "draw labels",
+    "draw pane",
+    "draw commands",
+    "draw prompt",
+    "present",
+};
+
 typedef enum DropType {
     DROP_HEAL,
     DROP_REFRESH,
@@ -123,6 +241,7 @@ typedef enum CommandType {
     COMMAND_START_MEDIUM,
     COMMAND_START_HARD,
     COMMAND_START_MONKEYTYPE,
+    COMMAND_START_HORDE,
 
     COMMAND_EXIT_GAME,
 
@@ -142,7 +261,8 @@ typedef struct Command {
     bool show_cooldown;
     char name[MAX_WORD_LEN];
 
-    Texture2D icon_texture;
+    Rectangle icon;  // region in the atlas, empty if the command has no icon
+    unsigned int required_resources;  // RESOURCE_* it waits for
 
     CommandType type;
 
@@ -163,11 +283,54 @@ typedef struct Command {
     };
 } Command;
 
+typedef enum EventType {
+    EVENT_ENEMY_SHOT,    // its name is submitted, it explodes
+    EVENT_ENEMY_KILLED,  // the explosion is over, it's removed
+    EVENT_PLAYER_HIT,
+    EVENT_PLAYER_STEP,
+    EVENT_COMMAND_FIRED,
+    EVENT_DROP_PICKED,
+} EventType;
+
+// What happened in the simulation. It only pushes the events, their side effects
+// belong to the consumers: the stats and the replay hashes run in every mode,
+// the audio, the camera and the vfx only in the interactive game
+typedef struct Event {
+    EventType type;
+    Vector3 position;  // of the enemy, the player or the drop
+
+    union {
+        struct {
+            Vector3 origin;  // the player's position
+        } shot;
+
+        struct {
+            float damage;
+            bool is_attack;  // by the enemy at the position, or a wrong command
+        } hit;
+
+        struct {
+            CommandType type;
+            bool is_stop;  // continue and unfreeze
+        } command;
+
+        struct {
+            DropType type;
+        } drop;
+    };
+} Event;
+
+// Events of the current tick, cleared when the next one starts. A tick which
+// overflows the ring keeps its latest events
+typedef struct Events {
+    int n;  // pushed in this tick
+    Event ring[MAX_N_EVENTS];
+} Events;
+
 typedef struct AnimatedSprite {
-    Texture2D texture;
+    Rectangle region;  // of the whole strip in the atlas
     int n_frames;
     int frame_width;
-    int frame_idx;
     int fps;
 
     float time;
@@ -180,13 +343,16 @@ typedef enum PlayerState {
     PLAYER_SHOOT,
     PLAYER_HURT,
     PLAYER_DEATH,
+    N_PLAYER_STATES,
 } PlayerState;
 
 typedef struct Player {
     Transform transform;
+    Transform prev_transform;  // at the previous tick, for render interpolation
     float max_health;
     float health;
     float step_time;
+    bool is_invulnerable;  // takes the damage but never dies, for the bench
 
     PlayerState state;
     PlayerState next_state;
@@ -199,37 +365,150 @@ typedef enum EnemyState {
     ENEMY_ATTACK,
     ENEMY_FREEZE,
     ENEMY_EXPLODE,
+    N_ENEMY_STATES,
 } EnemyState;
 
-typedef struct Enemy {
-    Transform transform;
-    float speed;
-    float attack_strength;
-    float attack_cooldown;
-    float recent_attack_time;
-    char name[MAX_WORD_LEN];
-
-    struct {
-        float speed;
-        float deceleration;
-        Vector3 direction;
-    } impulse;
-
-    EnemyState state;
-    EnemyState next_state;
-    AnimatedSprite animated_sprite;
+// Enemies are stored as a structure of arrays, so the per-tick loops only touch
+// the fields they need. The sprite sheet isn't stored at all: it's defined by
+// the state (see Resources.enemy_sprites), only the animation time is per enemy
+typedef struct Enemies {
+    int n;
 
-    // for sorting
-    int n_matched_chars;
-} Enemy;
+    // hot, touched by every tick
+    Vector3 position[MAX_N_HORDE_ENEMIES];
+    Vector3 impulse_direction[MAX_N_HORDE_ENEMIES];
+    float impulse_speed[MAX_N_HORDE_ENEMIES];
+    float impulse_deceleration[MAX_N_HORDE_ENEMIES];
+    float speed[MAX_N_HORDE_ENEMIES];
+    float recent_attack_time[MAX_N_HORDE_ENEMIES];
+    float sprite_time[MAX_N_HORDE_ENEMIES];
+    EnemyState state[MAX_N_HORDE_ENEMIES];
+    EnemyState next_state[MAX_N_HORDE_ENEMIES];
+
+    // rendering
+    Vector3 prev_position[MAX_N_HORDE_ENEMIES];
+    Quaternion rotation[MAX_N_HORDE_ENEMIES];
+    Quaternion prev_rotation[MAX_N_HORDE_ENEMIES];
+    int order[MAX_N_HORDE_ENEMIES];  // draw order, by the number of matched chars
+
+    // cold
+    char name[MAX_N_HORDE_ENEMIES][MAX_WORD_LEN];
+
+    // scratch of separate_enemies: the enemies which can collide, sorted by
+    // their grid cell column by column, and their positions next to each other
+    int cell_start[GRID_SIZE * GRID_SIZE + 1];
+    int sorted[MAX_N_HORDE_ENEMIES];
+    float sorted_x[MAX_N_HORDE_ENEMIES];
+    float sorted_y[MAX_N_HORDE_ENEMIES];
+} Enemies;
 
 #define MAX_N_ROULETTE_SOUNDS 8
 typedef struct SoundsRoulette {
     int n;
     int i;
-    Sound sounds[MAX_N_ROULETTE_SOUNDS];
+    int samples[MAX_N_ROULETTE_SOUNDS];  // of Resources.voices
 } SoundsRoulette;
 
+// Input consumed by the simulation during one update. It's filled either from
+// the keyboard (update_keyboard_input) or from a synthetic source (update_bot_input),
+// so the simulation itself never touches raylib input state
+typedef struct Input {
+    int pressed_char;
+    bool is_enter_pressed;
+    bool is_backspace_pressed;
+    bool is_exit_pressed;
+
+    bool is_up_down;
+    bool is_down_down;
+    bool is_left_down;
+    bool is_right_down;
+} Input;
+
+typedef enum ReplayMode {
+    REPLAY_OFF,
+    REPLAY_RECORD,
+    REPLAY_PLAY,
+} ReplayMode;
+
+// Fixed timestep loop state. Keyboard events are collected once per frame and
+// handed out to the simulation ticks: pressed keys go to the first tick which runs
+// after them, typed characters are handed out one per tick
+typedef struct Loop {
+    float tick_dt;
+    float accumulator;
+
+    Input input;
+    int n_pending_chars;
+    int pending_chars[MAX_N_PENDING_CHARS];
+
+    // --record and --replay, see apply_replay_input and update_replay
+    ReplayMode replay_mode;
+    Replay replay;
+    int replay_diverged_tick;  // -1 while the world hashes match
+} Loop;
+
+// Synthetic typist for headless runs: types the start command in the menu and then
+// the name of the closest enemy, one character per key period
+typedef struct Bot {
+    const char *start_command;  // NULL: stays in the menu
+    float cpm;
+    bool is_command_storm;  // every other word is repulse or decay, in turns
+    float key_countdown;
+    int n_words;  // submitted
+} Bot;
+
+// Fixed headless workload of --bench, see SCENARIOS
+typedef struct Scenario {
+    const char *name;
+    const char *start_command;
+    float cpm;
+    int n_ticks;
+    int max_n_enemies;  // 0: the one of the started mode
+    bool is_invulnerable;
+    bool is_command_storm;  // with the command cooldowns zeroed
+} Scenario;
+
+static const Scenario SCENARIOS[] = {
+    {.name = "menu", .start_command = NULL, .cpm = BOT_CPM, .n_ticks = 12000},
+    {.name = "normal",
+     .start_command = "medium",
+     .cpm = BOT_CPM,
+     .n_ticks = 72000,
+     .is_invulnerable = true},
+    {.name = "monkeytype",
+     .start_command = "monkeytype",
+     .cpm = BOT_CPM,
+     .n_ticks = 72000,
+     .is_invulnerable = true},
+    {.name = "horde_1k",
+     .start_command = "horde",
+     .cpm = BOT_CPM,
+     .n_ticks = 12000,
+     .max_n_enemies = 1000,
+     .is_invulnerable = true},
+    {.name = "horde_10k",
+     .start_command = "horde",
+     .cpm = BOT_CPM,
+     .n_ticks = 12000,
+     .max_n_enemies = 10000,
+     .is_invulnerable = true},
+    {.name = "command_storm",
+     .start_command = "horde",
+     .cpm = 1000.0,
+     .n_ticks = 12000,
+     .max_n_enemies = 1000,
+     .is_invulnerable = true,
+     .is_command_storm = true},
+};
+
+// Simulation parameters which the batch runner sweeps, the game plays with
+// get_default_tuning
+typedef struct Tuning {
+    int difficulty;  // 0: the one of the start command, see DIFFICULTY_*
+    float base_spawn_period;
+    int boss_spawn_period;
+} Tuning;
+
 typedef enum WorldState {
     STATE_MENU,
     STATE_PLAYING,
@@ -238,10 +517,18 @@ typedef enum WorldState {
 } WorldState;
 
 typedef struct World {
+    Input input;
+    unsigned int seed;  // of the game, a restart continues with the next one
+    Tuning tuning;
+    Rng rng;            // gameplay randomness
+    Rng cosmetic_rng;   // sounds and camera shake, never affects the simulation
     float roar_time;
 
     Player player;
-    Shot shot;
+    Events events;  // of the current tick
+
+    int n_shots;
+    Shot shots[MAX_N_SHOTS];  // traces, oldest first
 
     int n_drops;
     Drop drops[MAX_N_DROPS];
@@ -251,8 +538,13 @@ typedef struct World {
 
     int n_enemies_spawned;  // in total
     int n_enemies_killed;
-    int n_enemies;
-    Enemy enemies[MAX_N_ENEMIES];
+    int max_n_enemies;
+    bool is_horde;
+    Enemies enemies;
+    Grid enemies_grid;
+
+    // names of the enemies and commands, see ENEMY_TARGET and COMMAND_TARGET
+    Matcher matcher;
 
     char prompt[MAX_WORD_LEN];
     char submit_word[MAX_WORD_LEN];
@@ -276,26 +568,51 @@ typedef struct World {
 } World;
 
 typedef struct Resources {
+    Pack pack;  // mapped for the whole run: music and word lists point into it
+    Assets assets;  // manifest, decoded data is freed once it's uploaded
+
+#if defined(PLATFORM_WEB)
+    // the page preloads only what the menu and the gameplay need, the audio is
+    // fetched by the first frame, see get_lazy_assets
+    Pack lazy_pack;
+    Assets lazy_assets;
+    LazyPackState lazy_pack_state;
+    int n_lazy_pack_fetches;
+#endif
+
+    unsigned int resident_mask;  // RESOURCE_* groups ready to use
+    double load_start_time;
+
     Font command_font;
     Font stats_font;
 
-    Shader ground_shader;
+    Shaders shaders;
 
-    Mesh sprite_plane;
-    Material sprite_material;
+    Ground ground;
 
-    int n_enemy_names;
-    char enemy_names[MAX_N_ENEMY_NAMES][MAX_WORD_LEN];
+    // player and enemies, drawn in one instanced call
+    SpriteBatch sprite_batch;
 
-    int n_boss_names;
-    char boss_names[MAX_N_ENEMY_NAMES][MAX_WORD_LEN];
+    // laid out labels and ui text, drawn in one batch per layer
+    TextCache text_cache;
 
-    Music growling_music;
-    Music water_dropping_music;
+    // phase timers of the interactive game, NULL in headless and batch runs
+    Profiler *profiler;
+
+    Words enemy_names;
+    Words boss_names;
+
+    // music streams live on the audio worker, these are its music ids
+    AudioWorker audio;
+    SpatialMixer mixer;  // spreads the growling over the running enemies
+    int growling_music;
+    int water_dropping_music;
 
     Model heal_model;
     Model refresh_model;
 
+    // every sound plays through the pool, the roulettes pick its samples
+    VoicePool voices;
     SoundsRoulette roar_sounds;
     SoundsRoulette player_step_sounds;
     SoundsRoulette enemy_attack_sounds;
@@ -312,187 +629,985 @@ typedef struct Resources {
 
     Texture2D commands_pane_texture;
 
-    Texture2D exit_icon_texture;
-    Texture2D restart_icon_texture;
-    Texture2D pause_icon_texture;
-    Texture2D cryonics_icon_texture;
-    Texture2D repulse_icon_texture;
-    Texture2D decay_icon_texture;
-    Texture2D health_icon_texture;
-    Texture2D enemy_icon_texture;
-
-    Texture2D player_idle_texture;
-    Texture2D player_run_texture;
-    Texture2D player_shoot_texture;
-    Texture2D player_hurt_texture;
-    Texture2D player_death_texture;
-
-    Texture2D enemy_idle_texture;
-    Texture2D enemy_run_texture;
-    Texture2D enemy_attack_texture;
-    Texture2D enemy_freeze_texture;
-    Texture2D enemy_explode_texture;
+    // sprite strips and icons, see load_atlas
+    Atlas atlas;
+
+    Rectangle exit_icon;
+    Rectangle restart_icon;
+    Rectangle pause_icon;
+    Rectangle cryonics_icon;
+    Rectangle repulse_icon;
+    Rectangle decay_icon;
+    Rectangle health_icon;
+    Rectangle enemy_icon;
+
+    AnimatedSprite player_sprites[N_PLAYER_STATES];
+    AnimatedSprite enemy_sprites[N_ENEMY_STATES];
 } Resources;
 
-static Resources RESOURCES;
-static World WORLD;
-static void main_update(void);
+// Everything of the interactive game, one heap allocation passed around instead
+// of globals. Worlds of the batch runner share the read-only resources
+typedef struct Game {
+    Resources resources;
+    World world;
+    Loop loop;
+    Profiler profiler;
+} Game;
+
+#if !defined(PLATFORM_WEB)
+// Games per tuning of a sweep, played by the bot on all cores. Game i of each
+// tuning has the same seed, so tunings are compared on the same spawns
+typedef struct Batch {
+    const Resources *resources;
+    Bot bot;
+    float tick_dt;
+    int n_max_ticks;
+    unsigned int seed;
+
+    int n_tunings;
+    Tuning tunings[MAX_N_SWEEP_VALUES * MAX_N_SWEEP_VALUES * MAX_N_SWEEP_VALUES];
+    int n_games_per_tuning;
+
+    // per game, indexed by tuning * n_games_per_tuning + game
+    int n_games;
+    float *survival_times;
+    int *kills;
+    float *cpms;
+
+    atomic_int next_game;
+} Batch;
+#endif
+
+static void main_update(void *arg);
 
 static void init_resources(Resources *resources);
-static void init_world(World *world, Resources *resources);
+static void start_loading(Resources *resources);
+static void update_loading(Resources *resources);
+static void finish_loading(Resources *resources);
+static float get_loading_progress(Resources *resources);
+static Assets *get_lazy_assets(Resources *resources);
+static bool is_audio_skipped(Resources *resources);
+#if defined(PLATFORM_WEB)
+static void request_lazy_pack(Resources *resources);
+static void on_lazy_pack_loaded(
+    unsigned int handle, void *arg, void *data, unsigned int size
+);
+static void on_lazy_pack_failed(
+    unsigned int handle, void *arg, int status, const char *text
+);
+#endif
+static void load_names(Resources *resources);
+static void load_models(Resources *resources);
+static void load_sprites(Resources *resources);
+static void load_audio(Resources *resources);
+static void play_musics(Resources *resources);
+static Tuning get_default_tuning(void);
+static void init_world(
+    World *world, Resources *resources, Tuning tuning, unsigned int seed
+);
 static void init_menu_commands(World *world);
 static void init_playing_commands(World *world, Resources *resources);
 static void init_game_over_commands(World *world, Resources *resources);
-static void init_spawn_position(World *world);
-static void update_world(World *world, Resources *resources);
+static void init_spawn_position(World *world, float u);
+static void add_command(World *world, Command command);
+static void clear_commands(World *world);
+static void rename_command(World *world, int idx, const char *name);
+static void run_headless(
+    World *world, Resources *resources, Loop *loop, Bot *bot, int n_ticks
+);
+#if !defined(PLATFORM_WEB)
+static void run_batch(Batch *batch);
+static int run_bench(Resources *resources, const char *name, float tick_dt);
+static void *batch_worker(void *arg);
+static int parse_sweep(const char *str, float *values);
+#endif
+static void update_keyboard_input(Loop *loop);
+static Input get_tick_input(Loop *loop);
+static void update_bot_input(Bot *bot, World *world, float dt);
+static void apply_replay_input(Loop *loop, World *world);
+static void update_replay(Loop *loop, World *world);
+static ReplayInput pack_replay_input(Input input);
+static Input unpack_replay_input(ReplayInput replay_input);
+static uint32_t hash_world(const World *world);
+static void update_world(World *world, Resources *resources, float dt);
 static void update_prompt(World *world);
 static void update_enemies_spawn(World *world, Resources *resources);
+static bool spawn_enemy(
+    World *world, Resources *resources, Vector3 position, float speed, uint32_t name_bits
+);
 static void update_commands(World *world, Resources *resources);
 static void update_enemies(World *world, Resources *resources);
-static void update_drops(World *world, Resources *resources);
+static void separate_enemies(Enemies *enemies, Grid *grid);
+static void separate_sorted_enemy(
+    float *x, float *y, int i, const int *range_start, const int *range_end, int n_ranges
+);
+static void scatter_sorted_enemies(Enemies *enemies, int n);
+static void update_enemies_order(World *world);
+static void update_drops(World *world);
 static void update_player(World *world, Resources *resources);
+static void update_stats(World *world);
 static void update_camera(World *world);
+static void update_vfx(World *world);
+static void push_event(World *world, Event event);
+static void push_command_event(World *world, CommandType type, bool is_stop);
+static int get_first_event(const Events *events);
+static const Event *get_event(const Events *events, int i);
+static const Event *find_last_event(const Events *events, EventType type);
+static void get_typing_stats(const World *world, float *accuracy, float *cpm);
 static void update_audio(World *world, Resources *resources);
+static void play_event_sounds(World *world, Resources *resources);
 static void update_animated_sprite(AnimatedSprite *animated_sprite, float dt);
-static void draw_world(World *world, Resources *resources);
-static void draw_arena(Vector3 light_pos, float radius, Resources *resources);
-static void draw_text(
-    Font font, const char *text, Vector2 position, const char *match_prompt
+static void draw_world(World *world, Resources *resources, float alpha);
+static void draw_arena(Vector3 light_pos, Resources *resources);
+static void push_animated_sprite(
+    SpriteBatch *batch, AnimatedSprite animated_sprite, Transform transform, float time
 );
-static void draw_sprite_2d(Texture2D texture, Vector2 position, Resources *resources);
-static void draw_animated_sprite(
-    AnimatedSprite animated_sprite, Transform transform, Resources *resources
+static Transform get_interpolated_transform(Transform prev, Transform curr, float alpha);
+static Texture2D load_icon(Assets *assets, const char *name);
+static void load_atlas(Atlas *atlas, Assets *assets);
+static SoundsRoulette load_sounds_roulette(
+    Assets *assets, VoicePool *voices, const char *prefix
 );
-static Texture2D load_icon(const char *fp);
-static Texture2D load_sprite(const char *fp);
-static SoundsRoulette load_sounds_roulette(char *prefix);
-static int sort_enemies(const void *enemy1, const void *enemy2);
-static float frand_01(void);
-static float frand_centered(void);
-static float frand_range(float left, float right);
-static AnimatedSprite get_animated_sprite(Texture2D texture, bool is_repeat);
+static Music load_music(Assets *assets, const char *file_path);
+static void load_word_list(Words *words, Assets *assets, const char *file_path);
+static void sort_enemies(Enemies *enemies, Matcher *matcher);
+static AnimatedSprite get_animated_sprite(Rectangle region, bool is_repeat);
 static bool is_animated_sprite_finished(AnimatedSprite animated_sprite);
-static void play_sounds_roulette(SoundsRoulette *sounds, float vol);
-static void play_sounds_roulette_rnd(SoundsRoulette *sounds, float vol);
+static AnimatedSprite get_enemy_animated_sprite(
+    Enemies *enemies, int idx, Resources *resources
+);
+static void play_sounds_roulette(VoicePool *voices, SoundsRoulette *sounds, float vol);
+static void play_sounds_roulette_rnd(
+    VoicePool *voices, SoundsRoulette *sounds, Rng *rng, float vol, float pan
+);
+
+int main(int argc, char **argv) {
+    bool is_headless = false;
+    int n_ticks = HEADLESS_N_TICKS;
+    int tick_rate = SIM_TICK_RATE;
+    Bot bot = {.start_command = "medium", .cpm = BOT_CPM};
+    unsigned int seed = time(NULL);
+    const char *record_file_path = NULL;
+    const char *replay_file_path = NULL;
+    bool is_hashes = false;
+
+#if !defined(PLATFORM_WEB)
+    const char *bench_name = NULL;
+
+    // --batch: games per tuning and the swept values, a sweep defaults to the
+    // game's constant
+    int n_batch_games = 0;
+    int n_difficulties = 4;
+    float difficulties[MAX_N_SWEEP_VALUES] = {
+        DIFFICULTY_EASY, DIFFICULTY_MEDIUM, DIFFICULTY_HARD, DIFFICULTY_MONKEYTYPE};
+    int n_spawn_periods = 1;
+    float spawn_periods[MAX_N_SWEEP_VALUES] = {BASE_SPAWN_PERIOD};
+    int n_boss_periods = 1;
+    float boss_periods[MAX_N_SWEEP_VALUES] = {BOSS_SPAWN_PERIOD};
+#endif
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            is_headless = true;
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            n_ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--difficulty") == 0 && i + 1 < argc) {
+            bot.start_command = argv[++i];
+        } else if (strcmp(argv[i], "--cpm") == 0 && i + 1 < argc) {
+            bot.cpm = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            tick_rate = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_file_path = argv[++i];
+        } else if (strcmp(argv[i], "--hashes") == 0) {
+            is_hashes = true;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_file_path = argv[++i];
+#if !defined(PLATFORM_WEB)
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_name = argv[++i];
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            n_batch_games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sweep-difficulty") == 0 && i + 1 < argc) {
+            n_difficulties = parse_sweep(argv[++i], difficulties);
+        } else if (strcmp(argv[i], "--sweep-spawn-period") == 0 && i + 1 < argc) {
+            n_spawn_periods = parse_sweep(argv[++i], spawn_periods);
+        } else if (strcmp(argv[i], "--sweep-boss-period") == 0 && i + 1 < argc) {
+            n_boss_periods = parse_sweep(argv[++i], boss_periods);
+#endif
+        } else {
+            printf(
+                "Usage: %s [--headless] [--ticks N] [--difficulty NAME] [--cpm CPM] "
+                "[--tick-rate HZ] [--seed N] [--record FILE [--hashes]] "
+                "[--replay FILE]\n"
+                "       %s --batch N [--sweep-difficulty A,B,..] "
+                "[--sweep-spawn-period A,B,..] [--sweep-boss-period A,B,..] "
+                "[--cpm CPM] [--ticks N] [--seed N]\n"
+                "       %s --bench SCENARIO\n",
+                argv[0],
+                argv[0],
+                argv[0]
+            );
+            return 1;
+        }
+    }
+
+    Game *game = calloc(1, sizeof(Game));
+    Resources *resources = &game->resources;
+    World *world = &game->world;
+    Loop *loop = &game->loop;
+
+#if !defined(PLATFORM_WEB)
+    if (bench_name) {
+        init_resources(resources);
+        return run_bench(resources, bench_name, 1.0 / max(tick_rate, 1));
+    }
+
+    if (n_batch_games > 0) {
+        Batch *batch = calloc(1, sizeof(Batch));
+        batch->resources = resources;
+        batch->bot = bot;
+        batch->tick_dt = 1.0 / max(tick_rate, 1);
+        batch->n_max_ticks = n_ticks;
+        batch->seed = seed;
+        batch->n_games_per_tuning = n_batch_games;
+        for (int d = 0; d < n_difficulties; ++d) {
+            for (int s = 0; s < n_spawn_periods; ++s) {
+                for (int b = 0; b < n_boss_periods; ++b) {
+                    batch->tunings[batch->n_tunings++] = (Tuning){
+                        .difficulty = max((int)difficulties[d], 1),
+                        .base_spawn_period = spawn_periods[s],
+                        .boss_spawn_period = max((int)boss_periods[b], 1),
+                    };
+                }
+            }
+        }
+
+        init_resources(resources);
+        run_batch(batch);
+        return 0;
+    }
+#endif
+
+    // a replay brings its own seed and tick rate
+    loop->replay_diverged_tick = -1;
+    if (replay_file_path) {
+        if (!load_replay(&loop->replay, replay_file_path)) return 1;
+        loop->replay_mode = REPLAY_PLAY;
+        seed = loop->replay.seed;
+        tick_rate = loop->replay.tick_rate;
+    } else if (record_file_path) {
+        loop->replay_mode = REPLAY_RECORD;
+        init_replay(&loop->replay, seed, max(tick_rate, 1), is_hashes);
+    }
+    loop->tick_dt = 1.0 / max(tick_rate, 1);
+
+    // headless mode runs the simulation only: no window, no GPU and no audio device
+    if (is_headless) {
+        init_resources(resources);
+        init_world(world, resources, get_default_tuning(), seed);
+        run_headless(world, resources, loop, &bot, n_ticks);
+        if (record_file_path) save_replay(&loop->replay, record_file_path);
+        return 0;
+    }
 
-int main(void) {
     SetConfigFlags(FLAG_MSAA_4X_HINT);
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "texor");
     InitAudioDevice();
 
-    init_resources(&RESOURCES);
-    init_world(&WORLD, &RESOURCES);
+    // the menu shows up as soon as its own resources are here, the rest is
+    // loaded while it's up
+    if (loop->replay_mode == REPLAY_OFF) {
+        start_loading(resources);
+    } else {
+        init_resources(resources);
+    }
+    init_world(world, resources, get_default_tuning(), seed);
+    init_profiler(&game->profiler, PROFILE_ZONE_NAMES, N_PROFILE_ZONES);
+    resources->profiler = &game->profiler;
 
 #if defined(PLATFORM_WEB)
-    emscripten_set_main_loop(main_update, 0, 1);
+    emscripten_set_main_loop_arg(main_update, game, 0, 1);
 #else
     SetTargetFPS(60);
-    while (!WORLD.should_exit) {
-        main_update();
+    while (!world->should_exit) {
+        main_update(game);
     }
+    stop_audio_worker(&resources->audio);
+    detach_spatial_mixer(&resources->mixer);
+    if (record_file_path) save_replay(&loop->replay, record_file_path);
 #endif
 }
 
-static void main_update(void) {
-    update_world(&WORLD, &RESOURCES);
-    draw_world(&WORLD, &RESOURCES);
+static void main_update(void *arg) {
+    Game *game = arg;
+    Resources *resources = &game->resources;
+    World *world = &game->world;
+    Loop *loop = &game->loop;
+    Profiler *profiler = resources->profiler;
+    begin_profile_frame(profiler);
+    update_keyboard_input(loop);
+
+    // F3 toggles the profiler overlay, F5 saves the recent frames as a trace
+    if (IsKeyPressed(KEY_F3)) profiler->is_overlay_visible ^= true;
+    if (IsKeyPressed(KEY_F5)) save_profile_trace(profiler, PROFILE_TRACE_FILE_PATH);
+
+    // advance the simulation in fixed ticks, a long frame (hitch) is clamped
+    // instead of being fed into the simulation as a huge dt
+    loop->accumulator += fminf(GetFrameTime(), MAX_FRAME_TIME);
+    while (loop->accumulator >= loop->tick_dt) {
+        update_voice_pool(&resources->voices);
+        world->input = get_tick_input(loop);
+        apply_replay_input(loop, world);
+        update_world(world, resources, loop->tick_dt);
+        update_replay(loop, world);
+
+        // presentation consumers of the tick's events, headless, batch and
+        // bench runs skip them
+        update_camera(world);
+        update_vfx(world);
+        update_audio(world, resources);
+        loop->accumulator -= loop->tick_dt;
+    }
+
+    double zone_start = begin_profile_zone(profiler);
+    pump_audio_worker(&resources->audio);
+    end_profile_zone(profiler, ZONE_MUSIC, zone_start);
+
+    zone_start = begin_profile_zone(profiler);
+    update_loading(resources);
+    end_profile_zone(profiler, ZONE_LOADING, zone_start);
+
+    draw_world(world, resources, loop->accumulator / loop->tick_dt);
+    end_profile_frame(profiler);
 }
 
-static void init_resources(Resources *resources) {
-    // -------------------------------------------------------------------
-    // audio
-    resources->growling_music = LoadMusicStream("./resources/audio/growling.mp3");
-    SetMusicVolume(resources->growling_music, 0.0);
-    resources->water_dropping_music = LoadMusicStream(
-        "./resources/audio/water_dropping.mp3"
+static void run_headless(
+    World *world, Resources *resources, Loop *loop, Bot *bot, int n_ticks
+) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // a replay runs all its ticks (restarts included) instead of the bot
+    bool is_replay = loop->replay_mode == REPLAY_PLAY;
+    if (is_replay) n_ticks = loop->replay.n_ticks;
+
+    int tick = 0;
+    while (tick < n_ticks && !world->should_exit
+           && (is_replay || world->state != STATE_GAME_OVER)) {
+        if (!is_replay) update_bot_input(bot, world, loop->tick_dt);
+        apply_replay_input(loop, world);
+        update_world(world, resources, loop->tick_dt);
+        update_replay(loop, world);
+        tick += 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    printf("ticks: %d\n", tick);
+    printf("elapsed: %.3f s\n", elapsed);
+    printf("ticks/s: %.0f\n", elapsed > 0.0 ? tick / elapsed : 0.0);
+    printf("us/tick: %.2f\n", tick > 0 ? elapsed * 1e6 / tick : 0.0);
+    printf("enemies: %d\n", world->enemies.n);
+    printf("game time: %.1f s\n", world->time);
+    printf("kills: %d\n", world->n_enemies_killed);
+    printf("seed: %u\n", world->seed);
+    if (is_replay && loop->replay.has_hashes) {
+        if (loop->replay_diverged_tick < 0) printf("replay: matches\n");
+        else printf("replay: diverged at tick %d\n", loop->replay_diverged_tick);
+    }
+}
+
+#if !defined(PLATFORM_WEB)
+static void run_batch(Batch *batch) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    batch->n_games = batch->n_tunings * batch->n_games_per_tuning;
+    batch->survival_times = calloc(batch->n_games, sizeof(float));
+    batch->kills = calloc(batch->n_games, sizeof(int));
+    batch->cpms = calloc(batch->n_games, sizeof(float));
+    batch->next_game = 0;
+
+    int n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1) n_threads = 1;
+    if (n_threads > MAX_N_BATCH_WORKERS) n_threads = MAX_N_BATCH_WORKERS;
+    if (n_threads > batch->n_games) n_threads = batch->n_games;
+
+    // the main thread is one of the workers
+    pthread_t threads[MAX_N_BATCH_WORKERS];
+    int n_started = 0;
+    for (int i = 1; i < n_threads; ++i) {
+        if (pthread_create(&threads[n_started], NULL, batch_worker, batch) != 0) break;
+        n_started += 1;
+    }
+    batch_worker(batch);
+    for (int i = 0; i < n_started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    // aggregated after the join, so the output doesn't depend on the scheduling
+    printf(
+        "difficulty,spawn_period,boss_period,games,survival_mean,survival_min,"
+        "survival_max,kills_mean,cpm_mean\n"
     );
+    for (int t = 0; t < batch->n_tunings; ++t) {
+        Tuning tuning = batch->tunings[t];
+        int n = batch->n_games_per_tuning;
+        double survival_sum = 0.0;
+        float survival_min = FLT_MAX;
+        float survival_max = 0.0;
+        double kills_sum = 0.0;
+        double cpm_sum = 0.0;
+        for (int g = t * n; g < (t + 1) * n; ++g) {
+            survival_sum += batch->survival_times[g];
+            survival_min = fminf(survival_min, batch->survival_times[g]);
+            survival_max = fmaxf(survival_max, batch->survival_times[g]);
+            kills_sum += batch->kills[g];
+            cpm_sum += batch->cpms[g];
+        }
+        printf(
+            "%d,%.2f,%d,%d,%.1f,%.1f,%.1f,%.1f,%.0f\n",
+            tuning.difficulty,
+            tuning.base_spawn_period,
+            tuning.boss_spawn_period,
+            n,
+            survival_sum / n,
+            survival_min,
+            survival_max,
+            kills_sum / n,
+            cpm_sum / n
+        );
+    }
+
+    fprintf(
+        stderr,
+        "batch: %d games on %d threads in %.2f s (%.1f games/s)\n",
+        batch->n_games,
+        n_started + 1,
+        elapsed,
+        elapsed > 0.0 ? batch->n_games / elapsed : 0.0
+    );
+}
+
+// Plays games until the batch is done, each worker reuses one world
+static void *batch_worker(void *arg) {
+    Batch *batch = arg;
+    World *world = malloc(sizeof(World));
+
+    while (true) {
+        int game = atomic_fetch_add(&batch->next_game, 1);
+        if (game >= batch->n_games) break;
+
+        Tuning tuning = batch->tunings[game / batch->n_games_per_tuning];
+        unsigned int seed = batch->seed + game % batch->n_games_per_tuning;
+        init_world(world, (Resources *)batch->resources, tuning, seed);
+
+        Bot bot = batch->bot;
+        for (int tick = 0; tick < batch->n_max_ticks; ++tick) {
+            if (world->state == STATE_GAME_OVER || world->should_exit) break;
+            update_bot_input(&bot, world, batch->tick_dt);
+            update_world(world, (Resources *)batch->resources, batch->tick_dt);
+        }
+
+        float accuracy, cpm;
+        get_typing_stats(world, &accuracy, &cpm);
+        batch->survival_times[game] = world->time;
+        batch->kills[game] = world->n_enemies_killed;
+        batch->cpms[game] = cpm;
+    }
+
+    free(world);
+    return NULL;
+}
+
+// Comma separated values, up to MAX_N_SWEEP_VALUES
+static int parse_sweep(const char *str, float *values) {
+    int n = 0;
+    while (*str && n < MAX_N_SWEEP_VALUES) {
+        char *end;
+        values[n++] = strtof(str, &end);
+        if (*end != ',') break;
+        str = end + 1;
+    }
+    return n;
+}
+
+// Runs one scenario with a fixed seed and prints a JSON line. The time and the
+// allocations are measured over the ticks only, the peak RSS is of the process
+static int run_bench(Resources *resources, const char *name, float tick_dt) {
+    const Scenario *scenario = NULL;
+    for (int i = 0; i < (int)(sizeof(SCENARIOS) / sizeof(SCENARIOS[0])); ++i) {
+        if (strcmp(SCENARIOS[i].name, name) == 0) scenario = &SCENARIOS[i];
+    }
+    if (!scenario) {
+        fprintf(stderr, "Unknown bench scenario: %s\n", name);
+        return 1;
+    }
+
+    World *world = malloc(sizeof(World));
+    init_world(world, resources, get_default_tuning(), 1);
+    world->player.is_invulnerable = scenario->is_invulnerable;
+    Bot bot = {
+        .start_command = scenario->start_command,
+        .cpm = scenario->cpm,
+        .is_command_storm = scenario->is_command_storm,
+    };
+
+#if defined(ALLOC_COUNT)
+    long n_allocs = get_alloc_count();
+#endif
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
-    resources->roar_sounds = load_sounds_roulette("roar");
-    resources->player_step_sounds = load_sounds_roulette("player_step");
-    resources->enemy_attack_sounds = load_sounds_roulette("enemy_attack");
-    resources->bite_sounds = load_sounds_roulette("bite");
-    resources->error_sounds = load_sounds_roulette("error");
-    resources->pause_sounds = load_sounds_roulette("pause");
-    resources->enemy_death_sounds = load_sounds_roulette("enemy_death");
-    resources->pickup_sounds = load_sounds_roulette("pickup");
-    resources->shot_sounds = load_sounds_roulette("shot");
-    resources->cryonics_sounds = load_sounds_roulette("cryonics");
-    resources->unfreeze_sounds = load_sounds_roulette("unfreeze");
-    resources->repulse_sounds = load_sounds_roulette("repulse");
-    resources->decay_sounds = load_sounds_roulette("decay");
+    int tick = 0;
+    for (; tick < scenario->n_ticks; ++tick) {
+        if (world->state == STATE_GAME_OVER || world->should_exit) break;
+
+        if (world->state == STATE_PLAYING) {
+            if (scenario->max_n_enemies > 0) {
+                world->max_n_enemies = scenario->max_n_enemies;
+            }
+            if (scenario->is_command_storm) {
+                for (int i = 0; i < world->n_commands; ++i) {
+                    world->commands[i].cooldown = 0.0;
+                }
+            }
+        }
+
+        update_bot_input(&bot, world, tick_dt);
+        update_world(world, resources, tick_dt);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf(
+        "{\"scenario\":\"%s\",\"ticks\":%d,\"kills\":%d,\"ns_per_tick\":%.1f,",
+        scenario->name,
+        tick,
+        world->n_enemies_killed,
+        tick > 0 ? elapsed * 1e9 / tick : 0.0
+    );
+#if defined(ALLOC_COUNT)
+    printf(
+        "\"allocs_per_tick\":%.4f,",
+        tick > 0 ? (double)(get_alloc_count() - n_allocs) / tick : 0.0
+    );
+#else
+    printf("\"allocs_per_tick\":null,");
+#endif
+    printf("\"peak_rss_kb\":%ld}\n", usage.ru_maxrss);
+
+    free(world);
+    return 0;
+}
+#endif
+
+// Blocking: everything is resident when it returns (headless, batch, bench and
+// replays, whose input must not depend on the loading time)
+static void init_resources(Resources *resources) {
+    start_loading(resources);
+    finish_loading(resources);
+}
+
+// The menu needs only the fonts, the ground and the prompt: they are loaded
+// before the first frame. Images and waves are decoded in the background, and
+// update_loading uploads them while the menu is up
+static void start_loading(Resources *resources) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    resources->load_start_time = start.tv_sec + start.tv_nsec * 1e-9;
+    resources->resident_mask = 0;
+
+    const char *font_file_path = "./resources/fonts/ShareTechMono-Regular.ttf";
+    Assets *assets = &resources->assets;
+    if (open_pack(&resources->pack, PACK_FILE_PATH)) {
+        scan_pack_assets(assets, &resources->pack);
+        set_pack_file_callbacks(&resources->pack);
+    } else {
+        scan_assets(assets, "./resources");
+    }
+
+    init_audio_worker(&resources->audio);
+    init_text_cache(&resources->text_cache);
 
     // -------------------------------------------------------------------
-    // init models, meshes and materials
-    resources->heal_model = LoadModel("./resources/models/heal.glb");
-    resources->refresh_model = LoadModel("./resources/models/refresh.glb");
+    // fonts and the ground (skipped in headless mode)
+    if (IsWindowReady()) {
+        request_asset_font(assets, font_file_path, 30);
+        request_asset_font(assets, font_file_path, 20);
+        decode_assets(assets, ASSET_TYPE_BIT(ASSET_FONT));
+
+        Asset *font_asset = get_asset(assets, font_file_path);
+        resources->command_font = load_font_from_asset(font_asset, 30);
+        SetTextureFilter(resources->command_font.texture, TEXTURE_FILTER_BILINEAR);
 
-    resources->sprite_plane = GenMeshPlane(6.0, 6.0, 2, 2);
-    resources->sprite_material = LoadMaterialDefault();
-    resources->sprite_material.shader = load_shader(0, "sprite.frag");
-    resources->ground_shader = load_shader(0, "ground.frag");
+        resources->stats_font = load_font_from_asset(font_asset, 20);
+        SetTextureFilter(resources->stats_font.texture, TEXTURE_FILTER_BILINEAR);
+
+        init_shaders(&resources->shaders);
+        load_ground(&resources->ground, &resources->shaders);
+    }
 
     // -------------------------------------------------------------------
-    // init sprites
-    // ui
-    resources->commands_pane_texture = load_icon("commands_pane");
+    // the rest is decoded on the worker threads
+    unsigned int type_mask = ASSET_TYPE_BIT(ASSET_IMAGE);
+    if (IsAudioDeviceReady()) type_mask |= ASSET_TYPE_BIT(ASSET_WAVE);
+    start_decode_assets(assets, type_mask);
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    TraceLog(
+        LOG_INFO,
+        "ASSETS: Menu is ready in %.1f ms",
+        (end.tv_sec + end.tv_nsec * 1e-9 - resources->load_start_time) * 1e3
+    );
+}
+
+// Called once per frame until everything is resident. Uploads at most one group
+// of resources whose assets are decoded, so no frame does all the uploads
+static void update_loading(Resources *resources) {
+    if (resources->resident_mask == RESOURCES_ALL) return;
+
+#if defined(PLATFORM_WEB)
+    if (resources->lazy_pack_state == LAZY_PACK_NONE) request_lazy_pack(resources);
+#endif
+
+    // one decode budget per frame: the images first, then the lazily fetched waves
+    Assets *assets = &resources->assets;
+    Assets *lazy_assets = get_lazy_assets(resources);
+    bool are_images_decoded = are_assets_decoded(assets, ASSET_TYPE_BIT(ASSET_IMAGE));
+    pump_decode_assets(
+        are_images_decoded && lazy_assets ? lazy_assets : assets, LOADING_DECODE_BUDGET
+    );
+
+    unsigned int resident = resources->resident_mask;
+    bool are_waves_decoded = !IsAudioDeviceReady() || is_audio_skipped(resources);
+    if (!are_waves_decoded && lazy_assets) {
+        are_waves_decoded = are_assets_decoded(lazy_assets, ASSET_TYPE_BIT(ASSET_WAVE));
+    }
+    if (!(resident & RESOURCE_NAMES)) {
+        load_names(resources);
+    } else if (!(resident & RESOURCE_MODELS)) {
+        load_models(resources);
+    } else if (!(resident & RESOURCE_SPRITES) && are_images_decoded) {
+        load_sprites(resources);
+    } else if (!(resident & RESOURCE_AUDIO) && are_waves_decoded) {
+        load_audio(resources);
+    }
+    if (resources->resident_mask != RESOURCES_ALL) return;
+
+    // everything is uploaded: the workers are done, the decoded data can go
+    finish_decode_assets(assets);
+    unload_assets(assets);
+    if (lazy_assets && lazy_assets != assets) {
+        finish_decode_assets(lazy_assets);
+        unload_assets(lazy_assets);
+    }
+    if (IsWindowReady()) {
+        Shaders *shaders = &resources->shaders;
+        TraceLog(
+            LOG_INFO,
+            "SHADER: %d programs loaded from the cache, %d compiled",
+            shaders->n_cached,
+            shaders->n_compiled
+        );
+        unload_shaders(shaders);
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = end.tv_sec + end.tv_nsec * 1e-9 - resources->load_start_time;
+    TraceLog(
+        LOG_INFO,
+        "ASSETS: Loaded in %.1f ms (%d files scanned in %.1f ms, decoded in %.1f ms "
+        "on %d threads)",
+        elapsed * 1e3,
+        assets->n,
+        assets->scan_time * 1e3,
+        assets->decode_time * 1e3,
+        assets->n_threads
+    );
+}
+
+static void finish_loading(Resources *resources) {
+#if defined(PLATFORM_WEB)
+    // the fetch completes between frames, a blocking load can't wait for it
+    if (resources->lazy_pack_state != LAZY_PACK_OPEN) {
+        TraceLog(
+            LOG_WARNING, "PACK: %s is not fetched, loading without audio", LAZY_PACK_URL
+        );
+        resources->lazy_pack_state = LAZY_PACK_FAILED;
+    }
+#endif
+    finish_decode_assets(&resources->assets);
+    while (resources->resident_mask != RESOURCES_ALL) update_loading(resources);
+}
+
+// Fraction of the resident groups, shown on the commands which wait for them
+static float get_loading_progress(Resources *resources) {
+    int n_resident = 0;
+    int n_groups = 0;
+    for (unsigned int bit = 1; bit <= RESOURCES_ALL; bit <<= 1) {
+        if (!(RESOURCES_ALL & bit)) continue;
+        n_resident += (resources->resident_mask & bit) != 0;
+        n_groups += 1;
+    }
+    return (float)n_resident / n_groups;
+}
+
+// Manifest of the audio. On the web it's the lazy pack, NULL until it's fetched
+static Assets *get_lazy_assets(Resources *resources) {
+#if defined(PLATFORM_WEB)
+    if (resources->lazy_pack_state == LAZY_PACK_OPEN) return &resources->lazy_assets;
+    return NULL;
+#else
+    return &resources->assets;
+#endif
+}
+
+// The audio is optional: without the lazy pack the game is only silent
+static bool is_audio_skipped(Resources *resources) {
+#if defined(PLATFORM_WEB)
+    return resources->lazy_pack_state == LAZY_PACK_FAILED;
+#else
+    return false;
+#endif
+}
+
+#if defined(PLATFORM_WEB)
+// The download runs in the browser, its callbacks are called between frames
+static void request_lazy_pack(Resources *resources) {
+    resources->lazy_pack_state = LAZY_PACK_FETCHING;
+    resources->n_lazy_pack_fetches += 1;
+    emscripten_async_wget2_data(
+        LAZY_PACK_URL,
+        "GET",
+        NULL,
+        resources,
+        false,
+        on_lazy_pack_loaded,
+        on_lazy_pack_failed,
+        NULL
+    );
+}
+
+// The pack takes the fetched buffer (it's not freed after the callback), the
+// waves in it are decoded on the main thread, as the preloaded images are
+static void on_lazy_pack_loaded(
+    unsigned int handle, void *arg, void *data, unsigned int size
+) {
+    Resources *resources = arg;
+    if (resources->lazy_pack_state != LAZY_PACK_FETCHING) {
+        free(data);
+        return;
+    }
+    if (!open_pack_from_memory(&resources->lazy_pack, data, size, LAZY_PACK_URL)) {
+        resources->lazy_pack_state = LAZY_PACK_FAILED;
+        return;
+    }
+
+    Assets *assets = &resources->lazy_assets;
+    scan_pack_assets(assets, &resources->lazy_pack);
+    if (IsAudioDeviceReady()) start_decode_assets(assets, ASSET_TYPE_BIT(ASSET_WAVE));
+    resources->lazy_pack_state = LAZY_PACK_OPEN;
+}
+
+static void on_lazy_pack_failed(
+    unsigned int handle, void *arg, int status, const char *text
+) {
+    Resources *resources = arg;
+    TraceLog(
+        LOG_WARNING, "PACK: Failed to fetch %s (%d %s)", LAZY_PACK_URL, status, text
+    );
+    if (resources->lazy_pack_state != LAZY_PACK_FETCHING) return;
+
+    // update_loading requests it again on the next frame
+    if (resources->n_lazy_pack_fetches < MAX_N_LAZY_PACK_FETCHES) {
+        resources->lazy_pack_state = LAZY_PACK_NONE;
+    } else {
+        TraceLog(LOG_WARNING, "PACK: Giving up on %s, no audio", LAZY_PACK_URL);
+        resources->lazy_pack_state = LAZY_PACK_FAILED;
+    }
+}
+#endif
+
+static void load_names(Resources *resources) {
+    Assets *assets = &resources->assets;
+    load_word_list(&resources->boss_names, assets, "./resources/words/boss_names.txt");
+    load_word_list(&resources->enemy_names, assets, "./resources/words/enemy_names.txt");
+    if (resources->boss_names.n == 0) {
+        TraceLog(LOG_FATAL, "WORDS: Boss names are required to spawn enemies");
+    }
+    if (resources->enemy_names.n == 0) resources->enemy_names = resources->boss_names;
+
+    resources->resident_mask |= RESOURCE_NAMES;
+}
+
+// raylib opens and parses the models on the calling thread, they can't be split
+static void load_models(Resources *resources) {
+    if (IsWindowReady()) {
+        resources->heal_model = LoadModel("./resources/models/heal.glb");
+        resources->refresh_model = LoadModel("./resources/models/refresh.glb");
+    }
+
+    resources->resident_mask |= RESOURCE_MODELS;
+}
+
+// Sprites atlas (animations drive the simulation, so the regions are packed in
+// headless mode too, only the textures are skipped)
+static void load_sprites(Resources *resources) {
+    Assets *assets = &resources->assets;
+    Atlas *atlas = &resources->atlas;
+    load_atlas(atlas, assets);
+
+    // ui (the pane is scaled up, so it's kept out of the bilinear atlas)
+    if (IsWindowReady()) {
+        resources->commands_pane_texture = load_icon(assets, "commands_pane");
+    }
 
     // icons
-    resources->exit_icon_texture = load_icon("exit_icon");
-    resources->restart_icon_texture = load_icon("restart_icon");
-    resources->pause_icon_texture = load_icon("pause_icon");
-    resources->cryonics_icon_texture = load_icon("cryonics_icon");
-    resources->repulse_icon_texture = load_icon("repulse_icon");
-    resources->decay_icon_texture = load_icon("decay_icon");
-    resources->health_icon_texture = load_icon("health_icon");
-    resources->enemy_icon_texture = load_icon("enemy_icon");
+    resources->exit_icon = get_atlas_region(atlas, "exit_icon");
+    resources->restart_icon = get_atlas_region(atlas, "restart_icon");
+    resources->pause_icon = get_atlas_region(atlas, "pause_icon");
+    resources->cryonics_icon = get_atlas_region(atlas, "cryonics_icon");
+    resources->repulse_icon = get_atlas_region(atlas, "repulse_icon");
+    resources->decay_icon = get_atlas_region(atlas, "decay_icon");
+    resources->health_icon = get_atlas_region(atlas, "health_icon");
+    resources->enemy_icon = get_atlas_region(atlas, "enemy_icon");
 
     // player
-    resources->player_idle_texture = load_sprite("player_idle");
-    resources->player_run_texture = load_sprite("player_run");
-    resources->player_shoot_texture = load_sprite("player_shoot");
-    resources->player_hurt_texture = load_sprite("player_hurt");
-    resources->player_death_texture = load_sprite("player_death");
+    AnimatedSprite *player_sprites = resources->player_sprites;
+    player_sprites[PLAYER_IDLE] = get_animated_sprite(
+        get_atlas_region(atlas, "player_idle"), true
+    );
+    player_sprites[PLAYER_RUN] = get_animated_sprite(
+        get_atlas_region(atlas, "player_run"), true
+    );
+    player_sprites[PLAYER_SHOOT] = get_animated_sprite(
+        get_atlas_region(atlas, "player_shoot"), false
+    );
+    player_sprites[PLAYER_HURT] = get_animated_sprite(
+        get_atlas_region(atlas, "player_hurt"), false
+    );
+    player_sprites[PLAYER_DEATH] = get_animated_sprite(
+        get_atlas_region(atlas, "player_death"), false
+    );
+
     // enemy
-    resources->enemy_idle_texture = load_sprite("enemy_idle");
-    resources->enemy_run_texture = load_sprite("enemy_run");
-    resources->enemy_attack_texture = load_sprite("enemy_attack");
-    resources->enemy_freeze_texture = load_sprite("enemy_freeze");
-    resources->enemy_explode_texture = load_sprite("enemy_explode");
-    // -------------------------------------------------------------------
-    // init fonts
-    const char *font_file_path = "./resources/fonts/ShareTechMono-Regular.ttf";
-    resources->command_font = LoadFontEx(font_file_path, 30, 0, 0);
-    SetTextureFilter(resources->command_font.texture, TEXTURE_FILTER_BILINEAR);
+    AnimatedSprite *enemy_sprites = resources->enemy_sprites;
+    enemy_sprites[ENEMY_IDLE] = get_animated_sprite(
+        get_atlas_region(atlas, "enemy_idle"), true
+    );
+    enemy_sprites[ENEMY_RUN] = get_animated_sprite(
+        get_atlas_region(atlas, "enemy_run"), true
+    );
+    enemy_sprites[ENEMY_ATTACK] = get_animated_sprite(
+        get_atlas_region(atlas, "enemy_attack"), false
+    );
+    enemy_sprites[ENEMY_FREEZE] = get_animated_sprite(
+        get_atlas_region(atlas, "enemy_freeze"), true
+    );
+    enemy_sprites[ENEMY_EXPLODE] = get_animated_sprite(
+        get_atlas_region(atlas, "enemy_explode"), false
+    );
+
+    if (IsWindowReady()) {
+        init_sprite_batch(
+            &resources->sprite_batch,
+            load_shader(&resources->shaders, "sprite.vert", "sprite.frag"),
+            atlas->texture,
+            6.0
+        );
+    }
 
-    resources->stats_font = LoadFontEx(font_file_path, 20, 0, 0);
-    SetTextureFilter(resources->stats_font.texture, TEXTURE_FILTER_BILINEAR);
+    resources->resident_mask |= RESOURCE_SPRITES;
+}
 
-    // -------------------------------------------------------------------
-    // init names
-    FILE *f = fopen("./resources/words/enemy_names.txt", "r");
-    while (fgets(resources->enemy_names[resources->n_enemy_names], MAX_WORD_LEN, f)) {
-        char *name = resources->enemy_names[resources->n_enemy_names];
-        name[strcspn(name, "\n")] = 0;
+// Audio (skipped in headless mode and on the web without the lazy pack: sounds
+// roulettes stay empty and silent). The musics start as soon as they are here
+static void load_audio(Resources *resources) {
+    Assets *assets = get_lazy_assets(resources);
+    if (IsAudioDeviceReady() && assets) {
+        AudioWorker *audio = &resources->audio;
+        Music growling_music = load_music(assets, "./resources/audio/growling.mp3");
+        resources->growling_music = add_audio_music(audio, growling_music);
+        resources->water_dropping_music = add_audio_music(
+            audio, load_music(assets, "./resources/audio/water_dropping.mp3")
+        );
+        attach_spatial_mixer(
+            &resources->mixer, audio, growling_music, SPAWN_RADIUS * 2.0, 0.2
+        );
 
-        if (++resources->n_enemy_names >= MAX_N_ENEMY_NAMES) break;
+        VoicePool *voices = &resources->voices;
+        resources->roar_sounds = load_sounds_roulette(assets, voices, "roar");
+        resources->player_step_sounds = load_sounds_roulette(
+            assets, voices, "player_step"
+        );
+        resources->enemy_attack_sounds = load_sounds_roulette(
+            assets, voices, "enemy_attack"
+        );
+        resources->bite_sounds = load_sounds_roulette(assets, voices, "bite");
+        resources->error_sounds = load_sounds_roulette(assets, voices, "error");
+        resources->pause_sounds = load_sounds_roulette(assets, voices, "pause");
+        resources->enemy_death_sounds = load_sounds_roulette(
+            assets, voices, "enemy_death"
+        );
+        resources->pickup_sounds = load_sounds_roulette(assets, voices, "pickup");
+        resources->shot_sounds = load_sounds_roulette(assets, voices, "shot");
+        resources->cryonics_sounds = load_sounds_roulette(assets, voices, "cryonics");
+        resources->unfreeze_sounds = load_sounds_roulette(assets, voices, "unfreeze");
+        resources->repulse_sounds = load_sounds_roulette(assets, voices, "repulse");
+        resources->decay_sounds = load_sounds_roulette(assets, voices, "decay");
+
+        start_audio_worker(audio);
     }
-    fclose(f);
 
-    f = fopen("./resources/words/boss_names.txt", "r");
-    while (fgets(resources->boss_names[resources->n_boss_names], MAX_WORD_LEN, f)) {
-        char *name = resources->boss_names[resources->n_boss_names];
-        name[strcspn(name, "\n")] = 0;
-        if (++resources->n_boss_names >= MAX_N_ENEMY_NAMES) break;
-    }
-    fclose(f);
+    resources->resident_mask |= RESOURCE_AUDIO;
+    play_musics(resources);
+}
+
+static void play_musics(Resources *resources) {
+    if (!IsAudioDeviceReady() || !(resources->resident_mask & RESOURCE_AUDIO)) return;
+
+    AudioWorker *audio = &resources->audio;
+    AudioCommand command = {.type = AUDIO_PLAY_MUSIC};
+    command.music = resources->growling_music;
+    push_audio_command(audio, command);
+    command.music = resources->water_dropping_music;
+    push_audio_command(audio, command);
 }
 
-static void init_world(World *world, Resources *resources) {
-    SetRandomSeed(time(NULL));
+static Tuning get_default_tuning(void) {
+    return (Tuning){
+        .difficulty = 0,
+        .base_spawn_period = BASE_SPAWN_PERIOD,
+        .boss_spawn_period = BOSS_SPAWN_PERIOD,
+    };
+}
+
+static void init_world(
+    World *world, Resources *resources, Tuning tuning, unsigned int seed
+) {
     memset(world, 0, sizeof(World));
+    world->seed = seed;
+    world->tuning = tuning;
+    world->rng = rng_seed(seed, RNG_STREAM_GAMEPLAY);
+    world->cosmetic_rng = rng_seed(seed, RNG_STREAM_COSMETIC);
 
     // -------------------------------------------------------------------
     // init commands
+    matcher_init(&world->matcher);
     init_menu_commands(world);
 
     // -------------------------------------------------------------------
@@ -500,11 +1615,10 @@ static void init_world(World *world, Resources *resources) {
     world->player.transform.rotation = QuaternionIdentity();
     world->player.transform.scale = Vector3One();
     world->player.transform.translation = Vector3Zero();
+    world->player.prev_transform = world->player.transform;
     world->player.max_health = PLAYER_MAX_HEALTH;
     world->player.health = world->player.max_health;
-    world->player.animated_sprite = get_animated_sprite(
-        resources->player_idle_texture, true
-    );
+    world->player.animated_sprite = resources->player_sprites[PLAYER_IDLE];
 
     // -------------------------------------------------------------------
     // init camera
@@ -518,48 +1632,58 @@ static void init_world(World *world, Resources *resources) {
     // -------------------------------------------------------------------
     // init game parameters
     world->state = STATE_MENU;
+    world->max_n_enemies = MAX_N_ENEMIES;
     world->spawn_radius = SPAWN_RADIUS;
-    init_spawn_position(world);
+    grid_init(&world->enemies_grid, ENEMY_GRID_CELL_SIZE);
+    init_spawn_position(world, rng_float(&world->rng));
 
     // -------------------------------------------------------------------
-    // play music
-    PlayMusicStream(resources->growling_music);
-    PlayMusicStream(resources->water_dropping_music);
+    // play music (if it's loaded already, otherwise load_audio starts it)
+    play_musics(resources);
 }
 
 static void init_menu_commands(World *world) {
-    world->n_commands = 0;
+    clear_commands(world);
     Command command = {0};
 
+    // the start commands wait for the gameplay resources, see update_loading
+    command.required_resources = RESOURCES_GAMEPLAY;
+
     // start easy command
     command.type = COMMAND_START_EASY;
     strcpy(command.name, "easy");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 
     // start medium command
     command.type = COMMAND_START_MEDIUM;
     strcpy(command.name, "medium");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 
     // start hard command
     command.type = COMMAND_START_HARD;
     strcpy(command.name, "hard");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 
     // start monkeytype command
     command.type = COMMAND_START_MONKEYTYPE;
     strcpy(command.name, "monkeytype");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
+
+    // start horde command
+    command.type = COMMAND_START_HORDE;
+    strcpy(command.name, "horde");
+    add_command(world, command);
 
     // exit command
     command.type = COMMAND_EXIT_GAME;
     command.show_separator = true;
+    command.required_resources = 0;
     strcpy(command.name, "exit");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 }
 
 static void init_playing_commands(World *world, Resources *resources) {
-    world->n_commands = 0;
+    clear_commands(world);
     Command command = {0};
 
     // pause command
@@ -567,9 +1691,9 @@ static void init_playing_commands(World *world, Resources *resources) {
     command.time = command.cooldown;
     command.type = COMMAND_PAUSE;
     command.show_cooldown = true;
-    command.icon_texture = resources->pause_icon_texture;
+    command.icon = resources->pause_icon;
     strcpy(command.name, "pause");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 
     // cryonics command
     memset(&command, 0, sizeof(Command));
@@ -578,9 +1702,9 @@ static void init_playing_commands(World *world, Resources *resources) {
     command.type = COMMAND_CRYONICS;
     command.show_cooldown = true;
     command.cryonics.duration = CRYONICS_DURATION;
-    command.icon_texture = resources->cryonics_icon_texture;
+    command.icon = resources->cryonics_icon;
     strcpy(command.name, "cryonics");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 
     // repulse command
     memset(&command, 0, sizeof(Command));
@@ -591,9 +1715,9 @@ static void init_playing_commands(World *world, Resources *resources) {
     command.repulse.speed = REPULSE_SPEED;
     command.repulse.deceleration = REPULSE_DECELERATION;
     command.repulse.radius = REPULSE_RADIUS;
-    command.icon_texture = resources->repulse_icon_texture;
+    command.icon = resources->repulse_icon;
     strcpy(command.name, "repulse");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 
     // decay command
     memset(&command, 0, sizeof(Command));
@@ -602,38 +1726,63 @@ static void init_playing_commands(World *world, Resources *resources) {
     command.type = COMMAND_DECAY;
     command.show_cooldown = true;
     command.decay.strength = DECAY_STRENGTH;
-    command.icon_texture = resources->decay_icon_texture;
+    command.icon = resources->decay_icon;
     strcpy(command.name, "decay");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 
     // exit command
     memset(&command, 0, sizeof(Command));
     command.type = COMMAND_EXIT_GAME;
     command.show_cooldown = false;
-    command.icon_texture = resources->exit_icon_texture;
+    command.icon = resources->exit_icon;
     strcpy(command.name, "exit");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 }
 
 static void init_game_over_commands(World *world, Resources *resources) {
-    world->n_commands = 0;
+    clear_commands(world);
     Command command = {0};
 
     // restart command
     command.type = COMMAND_RESTART_GAME;
-    command.icon_texture = resources->restart_icon_texture;
+    command.icon = resources->restart_icon;
     strcpy(command.name, "restart");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
 
     // exit command
     command.type = COMMAND_EXIT_GAME;
-    command.icon_texture = resources->exit_icon_texture;
+    command.icon = resources->exit_icon;
     strcpy(command.name, "exit");
-    world->commands[world->n_commands++] = command;
+    add_command(world, command);
+}
+
+static void add_command(World *world, Command command) {
+    int i = world->n_commands;
+    if (!matcher_insert(&world->matcher, COMMAND_TARGET(i), command.name)) {
+        TraceLog(LOG_WARNING, "MATCHER: No room for command %s, skipped", command.name);
+        return;
+    }
+    world->commands[i] = command;
+    world->n_commands += 1;
+}
+
+static void clear_commands(World *world) {
+    for (int i = 0; i < world->n_commands; ++i) {
+        matcher_remove(&world->matcher, COMMAND_TARGET(i));
+    }
+    world->n_commands = 0;
+}
+
+static void rename_command(World *world, int idx, const char *name) {
+    strcpy(world->commands[idx].name, name);
+    if (!matcher_rename(&world->matcher, COMMAND_TARGET(idx), name)) {
+        TraceLog(LOG_WARNING, "MATCHER: No room for command %s, can't be typed", name);
+    }
 }
 
-static void init_spawn_position(World *world) {
-    float angle = frand_01() * 2 * PI;
+// u in [0, 1) picks the angle on the spawn circle
+static void init_spawn_position(World *world, float u) {
+    float angle = u * 2 * PI;
     world->spawn_position = (Vector3){
         .x = world->spawn_radius * cos(angle),
         .y = world->spawn_radius * sin(angle),
@@ -641,31 +1790,261 @@ static void init_spawn_position(World *world) {
     };
 }
 
-static void update_world(World *world, Resources *resources) {
+static void update_keyboard_input(Loop *loop) {
+    Input *input = &loop->input;
+
+    int pressed_char;
+    while ((pressed_char = GetCharPressed()) != 0) {
+        if (loop->n_pending_chars == MAX_N_PENDING_CHARS) break;
+        loop->pending_chars[loop->n_pending_chars++] = pressed_char;
+    }
+
+    input->is_enter_pressed |= IsKeyPressed(KEY_ENTER);
+    input->is_backspace_pressed |= IsKeyPressed(KEY_BACKSPACE)
+                                   || IsKeyPressedRepeat(KEY_BACKSPACE);
+
+#if !defined(PLATFORM_WEB)
     bool is_altf4_pressed = IsKeyDown(KEY_LEFT_ALT) && IsKeyPressed(KEY_F4);
+    input->is_exit_pressed |= (WindowShouldClose() || is_altf4_pressed)
+                              && !IsKeyPressed(KEY_ESCAPE);
+#endif
+
+    input->is_up_down = IsKeyDown(KEY_UP);
+    input->is_down_down = IsKeyDown(KEY_DOWN);
+    input->is_left_down = IsKeyDown(KEY_LEFT);
+    input->is_right_down = IsKeyDown(KEY_RIGHT);
+}
+
+static Input get_tick_input(Loop *loop) {
+    Input input = loop->input;
+
+    input.pressed_char = 0;
+    if (loop->n_pending_chars > 0) {
+        input.pressed_char = loop->pending_chars[0];
+        loop->n_pending_chars -= 1;
+        memmove(
+            &loop->pending_chars[0],
+            &loop->pending_chars[1],
+            sizeof(int) * loop->n_pending_chars
+        );
+    }
+
+    // pressed keys are consumed by this tick, held keys stay for the next ones
+    loop->input.is_enter_pressed = false;
+    loop->input.is_backspace_pressed = false;
+    loop->input.is_exit_pressed = false;
+
+    return input;
+}
+
+// Replaces the tick input with the recorded one. When the replay ends, the
+// keyboard (or the bot) takes over
+static void apply_replay_input(Loop *loop, World *world) {
+    if (loop->replay_mode != REPLAY_PLAY) return;
+
+    if (is_replay_finished(&loop->replay)) {
+        TraceLog(LOG_INFO, "REPLAY: Finished after %d ticks", loop->replay.n_ticks);
+        loop->replay_mode = REPLAY_OFF;
+        return;
+    }
+
+    // the window can still be closed during a replay
+    bool is_exit_pressed = world->input.is_exit_pressed;
+    world->input = unpack_replay_input(next_replay_input(&loop->replay));
+    world->input.is_exit_pressed |= is_exit_pressed;
+}
+
+// Records the input of the tick which just ran, or checks its world hash
+static void update_replay(Loop *loop, World *world) {
+    Replay *replay = &loop->replay;
+    if (loop->replay_mode == REPLAY_RECORD) {
+        uint32_t hash = replay->has_hashes ? hash_world(world) : 0;
+        record_replay_tick(replay, pack_replay_input(world->input), hash);
+    } else if (loop->replay_mode == REPLAY_PLAY && replay->has_hashes
+               && loop->replay_diverged_tick < 0) {
+        int tick = replay->tick - 1;
+        if (!check_replay_hash(replay, tick, hash_world(world))) {
+            TraceLog(LOG_WARNING, "REPLAY: Diverged at tick %d", tick);
+            loop->replay_diverged_tick = tick;
+        }
+    }
+}
+
+static ReplayInput pack_replay_input(Input input) {
+    ReplayInput replay_input = {.pressed_char = input.pressed_char};
+    if (input.is_enter_pressed) replay_input.keys |= REPLAY_KEY_ENTER;
+    if (input.is_backspace_pressed) replay_input.keys |= REPLAY_KEY_BACKSPACE;
+    if (input.is_exit_pressed) replay_input.keys |= REPLAY_KEY_EXIT;
+    if (input.is_up_down) replay_input.keys |= REPLAY_KEY_UP;
+    if (input.is_down_down) replay_input.keys |= REPLAY_KEY_DOWN;
+    if (input.is_left_down) replay_input.keys |= REPLAY_KEY_LEFT;
+    if (input.is_right_down) replay_input.keys |= REPLAY_KEY_RIGHT;
+    return replay_input;
+}
+
+static Input unpack_replay_input(ReplayInput replay_input) {
+    uint8_t keys = replay_input.keys;
+    return (Input){
+        .pressed_char = replay_input.pressed_char,
+        .is_enter_pressed = keys & REPLAY_KEY_ENTER,
+        .is_backspace_pressed = keys & REPLAY_KEY_BACKSPACE,
+        .is_exit_pressed = keys & REPLAY_KEY_EXIT,
+        .is_up_down = keys & REPLAY_KEY_UP,
+        .is_down_down = keys & REPLAY_KEY_DOWN,
+        .is_left_down = keys & REPLAY_KEY_LEFT,
+        .is_right_down = keys & REPLAY_KEY_RIGHT,
+    };
+}
 
+// Hash of the simulation state which gameplay depends on (not the camera or
+// the render interpolation), floats are hashed by their bits
+static uint32_t hash_world(const World *world) {
+    uint32_t h = REPLAY_HASH_INIT;
+    h = hash_replay_data(h, &world->state, sizeof(world->state));
+    h = hash_replay_data(h, &world->time, sizeof(world->time));
+    h = hash_replay_data(h, &world->spawn_countdown, sizeof(world->spawn_countdown));
+    h = hash_replay_data(h, &world->freeze_time, sizeof(world->freeze_time));
+    h = hash_replay_data(h, &world->n_enemies_spawned, sizeof(world->n_enemies_spawned));
+    h = hash_replay_data(h, &world->n_enemies_killed, sizeof(world->n_enemies_killed));
+    h = hash_replay_data(h, world->prompt, strlen(world->prompt));
+
+    const Player *player = &world->player;
+    h = hash_replay_data(h, &player->transform, sizeof(player->transform));
+    h = hash_replay_data(h, &player->health, sizeof(player->health));
+    h = hash_replay_data(h, &player->state, sizeof(player->state));
+
+    for (int i = 0; i < world->n_drops; ++i) {
+        h = hash_replay_data(h, &world->drops[i].position, sizeof(Vector3));
+    }
+
+    const Enemies *enemies = &world->enemies;
+    h = hash_replay_data(h, &enemies->n, sizeof(enemies->n));
+    h = hash_replay_data(h, enemies->position, sizeof(Vector3) * enemies->n);
+    h = hash_replay_data(h, enemies->state, sizeof(EnemyState) * enemies->n);
+    for (int i = 0; i < enemies->n; ++i) {
+        h = hash_replay_data(h, enemies->name[i], strlen(enemies->name[i]));
+    }
+
+    // the events of the tick too, so a replay also catches a divergence which
+    // leaves the state as it was
+    const Events *events = &world->events;
+    for (int i = get_first_event(events); i < events->n; ++i) {
+        const Event *event = get_event(events, i);
+        h = hash_replay_data(h, &event->type, sizeof(event->type));
+        h = hash_replay_data(h, &event->position, sizeof(event->position));
+    }
+
+    return h;
+}
+
+static void update_bot_input(Bot *bot, World *world, float dt) {
+    Input *input = &world->input;
+    memset(input, 0, sizeof(Input));
+
+    bot->key_countdown -= dt;
+    if (bot->key_countdown > 0.0) return;
+    bot->key_countdown += 60.0 / bot->cpm;
+
+    // pick the word to type: the closest enemy which name continues the prompt,
+    // or just the closest one if the prompt is already wrong
+    const char *target = NULL;
+    if (world->state == STATE_MENU) {
+        target = bot->start_command;
+    } else if (world->state == STATE_PLAYING && bot->is_command_storm
+               && bot->n_words % 2 == 0) {
+        CommandType type = bot->n_words % 4 == 0 ? COMMAND_REPULSE : COMMAND_DECAY;
+        for (int i = 0; i < world->n_commands; ++i) {
+            Command *command = &world->commands[i];
+            if (command->type == type && command->time >= command->cooldown) {
+                target = command->name;
+                break;
+            }
+        }
+    }
+
+    if (target == NULL && world->state == STATE_PLAYING) {
+        int prompt_len = strlen(world->prompt);
+        Matcher *matcher = &world->matcher;
+        float min_dist = FLT_MAX;
+        bool is_prefix_found = false;
+        Enemies *enemies = &world->enemies;
+        for (int i = 0; i < enemies->n; ++i) {
+            if (enemies->state[i] == ENEMY_EXPLODE) continue;
+
+            int n_matched = matcher_get_n_matched(matcher, ENEMY_TARGET(i));
+            bool is_prefix = n_matched == prompt_len;
+            if (is_prefix_found && !is_prefix) continue;
+
+            float dist = Vector3Distance(
+                enemies->position[i], world->player.transform.translation
+            );
+            if (dist < min_dist || (is_prefix && !is_prefix_found)) {
+                min_dist = dist;
+                target = enemies->name[i];
+                is_prefix_found = is_prefix;
+            }
+        }
+    }
+
+    if (target == NULL) return;
+
+    int prompt_len = strlen(world->prompt);
+    if (strcmp(world->prompt, target) == 0) {
+        input->is_enter_pressed = true;
+        bot->n_words += 1;
+    } else if (strncmp(world->prompt, target, prompt_len) != 0) {
+        input->is_backspace_pressed = true;
+    } else {
+        input->pressed_char = target[prompt_len];
+    }
+}
+
+static void update_world(World *world, Resources *resources, float dt) {
 #if !defined(PLATFORM_WEB)
-    world->should_exit = (WindowShouldClose() || is_altf4_pressed)
-                         && !IsKeyPressed(KEY_ESCAPE);
+    world->should_exit = world->input.is_exit_pressed;
 #endif
 
-    world->dt = world->state == STATE_PLAYING ? GetFrameTime() : 0.0;
+    // remember transforms of the previous tick for render interpolation
+    Enemies *enemies = &world->enemies;
+    world->player.prev_transform = world->player.transform;
+    memcpy(enemies->prev_position, enemies->position, sizeof(Vector3) * enemies->n);
+    memcpy(enemies->prev_rotation, enemies->rotation, sizeof(Quaternion) * enemies->n);
+
+    world->dt = world->state == STATE_PLAYING ? dt : 0.0;
     world->time += world->dt;
     world->freeze_time = fmaxf(0.0, world->freeze_time - world->dt);
     world->is_command_matched = false;
+    world->events.n = 0;
 
+    Profiler *profiler = resources->profiler;
+    double zone_start = begin_profile_zone(profiler);
     update_prompt(world);
+    end_profile_zone(profiler, ZONE_UPDATE_PROMPT, zone_start);
+
+    zone_start = begin_profile_zone(profiler);
     update_commands(world, resources);
-    update_camera(world);
+    end_profile_zone(profiler, ZONE_UPDATE_COMMANDS, zone_start);
+
+    zone_start = begin_profile_zone(profiler);
     update_enemies_spawn(world, resources);
+    end_profile_zone(profiler, ZONE_UPDATE_SPAWN, zone_start);
+
+    zone_start = begin_profile_zone(profiler);
     update_enemies(world, resources);
-    update_drops(world, resources);
-    update_player(world, resources);
-    update_audio(world, resources);
-    world->shot.time += world->dt;
+    end_profile_zone(profiler, ZONE_UPDATE_ENEMIES, zone_start);
 
-    UpdateMusicStream(resources->water_dropping_music);
-    UpdateMusicStream(resources->growling_music);
+    zone_start = begin_profile_zone(profiler);
+    update_enemies_order(world);
+    end_profile_zone(profiler, ZONE_UPDATE_ORDER, zone_start);
+
+    zone_start = begin_profile_zone(profiler);
+    update_drops(world);
+    end_profile_zone(profiler, ZONE_UPDATE_DROPS, zone_start);
+
+    zone_start = begin_profile_zone(profiler);
+    update_player(world, resources);
+    end_profile_zone(profiler, ZONE_UPDATE_PLAYER, zone_start);
+    update_stats(world);
 
     if (world->state == STATE_PLAYING && world->submit_word[0] != '\0'
         && !world->is_command_matched) {
@@ -673,40 +2052,46 @@ static void update_world(World *world, Resources *resources) {
     }
 
     world->submit_word[0] = '\0';
+    world->matcher.submit_node = -1;
 }
 
 static void update_prompt(World *world) {
+    Input *input = &world->input;
     int prompt_len = strlen(world->prompt);
-    int pressed_char = GetCharPressed();
-    if (IsKeyPressed(KEY_ENTER) > 0) {
+    int pressed_char = input->pressed_char;
+    if (input->is_enter_pressed) {
         if (world->state == STATE_PLAYING) {
             world->n_keystrokes_typed += strlen(world->prompt);
         }
 
         strcpy(world->submit_word, world->prompt);
         world->prompt[0] = '\0';
-    } else if ((IsKeyPressed(KEY_BACKSPACE) || IsKeyPressedRepeat(KEY_BACKSPACE)) && prompt_len > 0) {
+        matcher_submit(&world->matcher);
+    } else if (input->is_backspace_pressed && prompt_len > 0) {
         if (world->state == STATE_PLAYING) {
             world->n_backspaces_typed += 1;
             world->n_keystrokes_typed += 1;
         }
 
         world->prompt[--prompt_len] = '\0';
+        matcher_pop_char(&world->matcher);
     } else if (prompt_len < MAX_WORD_LEN - 1 && isprint(pressed_char)) {
         world->prompt[prompt_len++] = pressed_char;
         world->prompt[prompt_len] = '\0';
+        matcher_push_char(&world->matcher, pressed_char);
     }
 }
 
 static void update_enemies_spawn(World *world, Resources *resources) {
-    if (world->state != STATE_PLAYING || world->n_enemies == MAX_N_ENEMIES) return;
+    Enemies *enemies = &world->enemies;
+    if (world->state != STATE_PLAYING || enemies->n >= world->max_n_enemies) return;
 
     // don't update spawn_countdown if the world is frozen
     if (world->freeze_time <= EPSILON) {
 
         bool is_any_alive = false;
-        for (int i = 0; i < world->n_enemies; ++i) {
-            if (world->enemies[i].state != ENEMY_EXPLODE) {
+        for (int i = 0; i < enemies->n; ++i) {
+            if (enemies->state[i] != ENEMY_EXPLODE) {
                 is_any_alive = true;
                 break;
             }
@@ -721,44 +2106,79 @@ static void update_enemies_spawn(World *world, Resources *resources) {
     if (world->spawn_countdown > 0.0) return;
 
     // https://www.desmos.com/calculator/jp6dgyycwn
+    Tuning *tuning = &world->tuning;
+    int difficulty = tuning->difficulty > 0 ? tuning->difficulty : world->difficulty;
     world->spawn_period = fmaxf(
-        BASE_SPAWN_PERIOD * expf(-world->time * 0.001 * world->difficulty), 1.0
+        tuning->base_spawn_period * expf(-world->time * 0.001 * difficulty), 1.0
     );
+    if (world->is_horde) world->spawn_period = HORDE_SPAWN_PERIOD;
     world->spawn_countdown = world->spawn_period;
     float speed_factor = BASE_ENEMY_SPEED_FACTOR
                          + (MAX_ENEMY_SPEED_FACTOR - BASE_ENEMY_SPEED_FACTOR)
-                               * (1.0 - expf(-world->time * 0.001 * world->difficulty));
+                               * (1.0 - expf(-world->time * 0.001 * difficulty));
     float speed = PLAYER_SPEED * speed_factor;
 
-    Vector3 position = world->spawn_position;
-    init_spawn_position(world);
-
-    Enemy enemy = {
-        .transform={
-            .translation = position,
-            .rotation = QuaternionIdentity(),
-            .scale = Vector3One(),
-        },
-        .speed = speed,
-        .attack_strength = 10.0,
-        .attack_cooldown = 1.0,
-        .recent_attack_time = 0.0,
-        .animated_sprite = get_animated_sprite(resources->enemy_run_texture, true),
-    };
+    int n_spawn = world->is_horde ? HORDE_SPAWN_BATCH : 1;
+    n_spawn = min(n_spawn, world->max_n_enemies - enemies->n);
+    if (n_spawn <= 0) return;
+
+    // the randomness of the whole batch is drawn at once: the angles of the
+    // next spawn positions, then the names
+    float angles[HORDE_SPAWN_BATCH];
+    uint32_t name_bits[HORDE_SPAWN_BATCH];
+    rng_fill_floats(&world->rng, angles, n_spawn);
+    rng_fill_u32(&world->rng, name_bits, n_spawn);
+    for (int i = 0; i < n_spawn; ++i) {
+        Vector3 position = world->spawn_position;
+        init_spawn_position(world, angles[i]);
+        // the rest of the batch wouldn't fit into the matcher either
+        if (!spawn_enemy(world, resources, position, speed, name_bits[i])) break;
+    }
+}
 
-    if (++world->n_enemies_spawned % BOSS_SPAWN_PERIOD == 0) {
-        int idx = GetRandomValue(0, resources->n_boss_names - 1);
-        strcpy(enemy.name, resources->boss_names[idx]);
-    } else {
-        int idx = GetRandomValue(0, resources->n_enemy_names - 1);
-        strcpy(enemy.name, resources->enemy_names[idx]);
+// name_bits pick the name, as rng_int would from the same output
+static bool spawn_enemy(
+    World *world, Resources *resources, Vector3 position, float speed, uint32_t name_bits
+) {
+    Enemies *enemies = &world->enemies;
+    int i = enemies->n;
+
+    Words *names = &resources->enemy_names;
+    if ((world->n_enemies_spawned + 1) % world->tuning.boss_spawn_period == 0) {
+        names = &resources->boss_names;
+    }
+    WordView name = get_word(names, ((uint64_t)name_bits * names->n) >> 32);
+    memcpy(enemies->name[i], name.str, name.len);
+    enemies->name[i][name.len] = '\0';
+    if (!matcher_insert(&world->matcher, ENEMY_TARGET(i), enemies->name[i])) {
+        TraceLog(
+            LOG_WARNING, "MATCHER: No room for enemy %s, spawn skipped", enemies->name[i]
+        );
+        return false;
     }
-    world->enemies[world->n_enemies++] = enemy;
+
+    enemies->n += 1;
+    world->n_enemies_spawned += 1;
+    enemies->position[i] = position;
+    enemies->prev_position[i] = position;
+    enemies->rotation[i] = QuaternionIdentity();
+    enemies->prev_rotation[i] = enemies->rotation[i];
+    enemies->impulse_direction[i] = Vector3Zero();
+    enemies->impulse_speed[i] = 0.0;
+    enemies->impulse_deceleration[i] = 0.0;
+    enemies->speed[i] = speed;
+    enemies->recent_attack_time[i] = 0.0;
+    enemies->sprite_time[i] = 0.0;
+    enemies->state[i] = ENEMY_RUN;
+    enemies->next_state[i] = ENEMY_RUN;
+    grid_insert(&world->enemies_grid, i, (Vector2){position.x, position.y});
+
+    return true;
 }
 
 static void update_commands(World *world, Resources *resources) {
     float dt = world->dt;
-    const char *submit_word = world->submit_word;
+    Matcher *matcher = &world->matcher;
 
     for (int i = 0; i < world->n_commands; ++i) {
         Command *command = &world->commands[i];
@@ -766,12 +2186,14 @@ static void update_commands(World *world, Resources *resources) {
 
         if (strcmp("unfreeze", command->name) == 0 && world->freeze_time <= EPSILON) {
             command->time = 0.0;
-            strcpy(command->name, "cryonics");
+            rename_command(world, i, "cryonics");
             world->freeze_time = 0.0;
         }
 
-        bool is_ready = command->time >= command->cooldown;
-        bool is_command_matched = is_ready && strcmp(submit_word, command->name) == 0;
+        bool is_resident = !(command->required_resources & ~resources->resident_mask);
+        bool is_ready = is_resident && command->time >= command->cooldown;
+        bool is_command_matched = is_ready
+                                  && matcher_is_submitted(matcher, COMMAND_TARGET(i));
         world->is_command_matched |= is_command_matched;
         if (is_command_matched && is_ready) {
             if (command->type == COMMAND_EXIT_GAME) {
@@ -796,52 +2218,65 @@ static void update_commands(World *world, Resources *resources) {
                 world->difficulty = DIFFICULTY_MONKEYTYPE;
                 strcpy(world->difficulty_str, command->name);
                 init_playing_commands(world, resources);
+            } else if (command->type == COMMAND_START_HORDE) {
+                world->state = STATE_PLAYING;
+                world->difficulty = DIFFICULTY_HARD;
+                world->max_n_enemies = MAX_N_HORDE_ENEMIES;
+                world->is_horde = true;
+                strcpy(world->difficulty_str, command->name);
+                init_playing_commands(world, resources);
             } else if (command->type == COMMAND_PAUSE && world->state == STATE_PLAYING) {
                 command->time = command->cooldown + 1.0;
-                strcpy(command->name, "continue");
+                rename_command(world, i, "continue");
                 world->state = STATE_PAUSE;
-                play_sounds_roulette(&resources->pause_sounds, 1.0);
+                push_command_event(world, COMMAND_PAUSE, false);
             } else if (command->type == COMMAND_PAUSE && world->state == STATE_PAUSE) {
                 command->time = 0.0;
-                strcpy(command->name, "pause");
+                rename_command(world, i, "pause");
                 world->state = STATE_PLAYING;
-                play_sounds_roulette(&resources->pause_sounds, 1.0);
+                push_command_event(world, COMMAND_PAUSE, true);
             } else if (command->type == COMMAND_RESTART_GAME) {
-                init_world(world, resources);
+                init_world(world, resources, world->tuning, world->seed + 1);
             } else if (command->type == COMMAND_CRYONICS && world->state == STATE_PLAYING && world->freeze_time <= EPSILON) {
                 command->time = command->cooldown + 1.0;
-                strcpy(command->name, "unfreeze");
+                rename_command(world, i, "unfreeze");
                 world->freeze_time = command->cryonics.duration;
-                play_sounds_roulette(&resources->cryonics_sounds, 1.0);
+                push_command_event(world, COMMAND_CRYONICS, false);
             } else if (command->type == COMMAND_CRYONICS && world->freeze_time >= EPSILON) {
                 command->time = 0.0;
-                strcpy(command->name, "cryonics");
+                rename_command(world, i, "cryonics");
                 world->freeze_time = 0.0;
-                play_sounds_roulette(&resources->unfreeze_sounds, 1.0);
+                push_command_event(world, COMMAND_CRYONICS, true);
             } else if (command->type == COMMAND_REPULSE && world->state == STATE_PLAYING) {
                 command->time = 0.0;
-                for (int i = 0; i < world->n_enemies; ++i) {
-                    Enemy *enemy = &world->enemies[i];
-                    Vector3 vec = Vector3Subtract(
-                        enemy->transform.translation, world->player.transform.translation
-                    );
+                Enemies *enemies = &world->enemies;
+                Vector3 player_position = world->player.transform.translation;
+                GridQuery query = grid_query(
+                    &world->enemies_grid,
+                    (Vector2){player_position.x, player_position.y},
+                    command->repulse.radius
+                );
+                int i;
+                while (grid_query_next(&query, &i)) {
+                    Vector3 vec = Vector3Subtract(enemies->position[i], player_position);
                     float dist = Vector3Length(vec);
                     Vector3 dir = Vector3Normalize(vec);
                     if (dist < command->repulse.radius) {
-                        enemy->impulse.deceleration = command->repulse.deceleration;
-                        enemy->impulse.speed = command->repulse.speed;
-                        enemy->impulse.direction = dir;
+                        enemies->impulse_deceleration[i] = command->repulse.deceleration;
+                        enemies->impulse_speed[i] = command->repulse.speed;
+                        enemies->impulse_direction[i] = dir;
                     }
                 }
-                play_sounds_roulette(&resources->repulse_sounds, 1.0);
+                push_command_event(world, COMMAND_REPULSE, false);
             } else if (command->type == COMMAND_DECAY && world->state == STATE_PLAYING) {
                 command->time = 0.0;
-                for (int i = 0; i < world->n_enemies; ++i) {
-                    Enemy *enemy = &world->enemies[i];
-                    int len = max(1, strlen(enemy->name) / 2);
-                    enemy->name[len] = '\0';
+                Enemies *enemies = &world->enemies;
+                for (int i = 0; i < enemies->n; ++i) {
+                    int len = max(1, strlen(enemies->name[i]) / 2);
+                    enemies->name[i][len] = '\0';
+                    matcher_rename(matcher, ENEMY_TARGET(i), enemies->name[i]);
                 }
-                play_sounds_roulette(&resources->decay_sounds, 1.0);
+                push_command_event(world, COMMAND_DECAY, false);
             }
         }
     }
@@ -850,159 +2285,138 @@ static void update_commands(World *world, Resources *resources) {
 static void update_enemies(World *world, Resources *resources) {
     if (world->state != STATE_PLAYING) return;
 
-    const char *submit_word = world->submit_word;
-    int kill_enemy_idx = -1;
-
-    for (int i = 0; i < world->n_enemies; ++i) {
-        Enemy *enemy = &world->enemies[i];
-        update_animated_sprite(&enemy->animated_sprite, world->dt);
+    Enemies *enemies = &world->enemies;
+    Grid *grid = &world->enemies_grid;
+    Matcher *matcher = &world->matcher;
+    Vector3 player_position = world->player.transform.translation;
 
-        if (enemy->state != enemy->next_state) {
-            enemy->state = enemy->next_state;
-            if (enemy->state == ENEMY_IDLE) {
-                enemy->animated_sprite = get_animated_sprite(
-                    resources->enemy_idle_texture, true
-                );
-            } else if (enemy->state == ENEMY_RUN) {
-                enemy->animated_sprite = get_animated_sprite(
-                    resources->enemy_run_texture, true
-                );
-            } else if (enemy->state == ENEMY_ATTACK) {
-                enemy->animated_sprite = get_animated_sprite(
-                    resources->enemy_attack_texture, false
-                );
-            } else if (enemy->state == ENEMY_FREEZE) {
-                enemy->animated_sprite = get_animated_sprite(
-                    resources->enemy_freeze_texture, true
-                );
-            } else if (enemy->state == ENEMY_EXPLODE) {
-                enemy->animated_sprite = get_animated_sprite(
-                    resources->enemy_explode_texture, false
-                );
-            }
-        }
+    for (int i = 0; i < enemies->n; ++i) {
+        enemies->sprite_time[i] += world->dt;
 
-        // count number of matched chars with prompt
-        enemy->n_matched_chars = 0;
-        char *str1 = enemy->name;
-        char *str2 = world->prompt;
-        while (*str1 && *str2 && *str1 == *str2) {
-            enemy->n_matched_chars++;
-            str1++;
-            str2++;
+        if (enemies->state[i] != enemies->next_state[i]) {
+            enemies->state[i] = enemies->next_state[i];
+            enemies->sprite_time[i] = 0.0;
         }
 
-        if (strcmp(submit_word, enemy->name) == 0) {
-            world->shot = (Shot
-            ){.time = 0.0,
-              .trace_duration = SHOT_TRACE_DURATION,
-              .start_position = world->player.transform.translation,
-              .end_position = enemy->transform.translation};
-            enemy->next_state = ENEMY_EXPLODE;
+        if (matcher_is_submitted(matcher, ENEMY_TARGET(i))) {
+            push_event(
+                world,
+                (Event){.type = EVENT_ENEMY_SHOT,
+                        .position = enemies->position[i],
+                        .shot.origin = player_position}
+            );
+            enemies->next_state[i] = ENEMY_EXPLODE;
             world->is_command_matched = true;
-            play_sounds_roulette(&resources->shot_sounds, 1.0);
-            play_sounds_roulette(&resources->enemy_death_sounds, 1.0);
             continue;
         }
 
-        if (enemy->state == ENEMY_EXPLODE) {
-            if (is_animated_sprite_finished(enemy->animated_sprite)) {
-                kill_enemy_idx = i;
-            }
-            continue;
-        }
+        // exploded enemies are removed after the loop
+        if (enemies->state[i] == ENEMY_EXPLODE) continue;
 
         bool can_move = true;
         bool can_attack = true;
         Vector3 step = {0};
-        if (enemy->impulse.speed > 0.0) {
-            Vector3 dir = Vector3Normalize(enemy->impulse.direction);
-            step = Vector3Scale(dir, enemy->impulse.speed * world->dt);
-            enemy->impulse.speed -= enemy->impulse.deceleration * world->dt;
+        if (enemies->impulse_speed[i] > 0.0) {
+            Vector3 dir = Vector3Normalize(enemies->impulse_direction[i]);
+            step = Vector3Scale(dir, enemies->impulse_speed[i] * world->dt);
+            enemies->impulse_speed[i] -= enemies->impulse_deceleration[i] * world->dt;
             can_move = false;
             can_attack = false;
         }
-        enemy->transform.translation = Vector3Add(enemy->transform.translation, step);
+        enemies->position[i] = Vector3Add(enemies->position[i], step);
 
         if (world->freeze_time > EPSILON) {
-            enemy->next_state = ENEMY_FREEZE;
+            enemies->next_state[i] = ENEMY_FREEZE;
             continue;
         }
 
         // apply enemy movements and attacks
-        Vector3 dir = Vector3Subtract(
-            world->player.transform.translation, enemy->transform.translation
-        );
+        Vector3 dir = Vector3Subtract(player_position, enemies->position[i]);
         float dist_to_player = Vector3Length(dir);
         dir = Vector3Normalize(dir);
-        float time_since_last_attack = world->time - enemy->recent_attack_time;
+        float time_since_last_attack = world->time - enemies->recent_attack_time[i];
         can_attack &= dist_to_player <= (ENEMY_RADIUS + PLAYER_RADIUS)
-                      && time_since_last_attack > enemy->attack_cooldown;
+                      && time_since_last_attack > ENEMY_ATTACK_COOLDOWN;
         can_move &= dist_to_player > (ENEMY_RADIUS + PLAYER_RADIUS);
 
         if (can_attack) {
-            enemy->recent_attack_time = world->time;
-            world->player.health -= enemy->attack_strength;
+            enemies->recent_attack_time[i] = world->time;
+            world->player.health -= ENEMY_ATTACK_STRENGTH;
             world->player.next_state = PLAYER_HURT;
-            world->camera_shake = (CameraShake
-            ){.time = 0.0,
-              .duration = CAMERA_SHAKE_TIME,
-              .strength = enemy->attack_strength};
-            enemy->next_state = ENEMY_ATTACK;
-            play_sounds_roulette_rnd(&resources->enemy_attack_sounds, 1.0);
-            play_sounds_roulette_rnd(&resources->bite_sounds, 1.0);
+            enemies->next_state[i] = ENEMY_ATTACK;
+            push_event(
+                world,
+                (Event){.type = EVENT_PLAYER_HIT,
+                        .position = enemies->position[i],
+                        .hit = {ENEMY_ATTACK_STRENGTH, true}}
+            );
         } else if (can_move) {
-            Vector3 step = Vector3Scale(dir, enemy->speed * world->dt);
-            enemy->transform.translation = Vector3Add(enemy->transform.translation, step);
-            enemy->next_state = ENEMY_RUN;
-        } else if (enemy->state == ENEMY_ATTACK && is_animated_sprite_finished(enemy->animated_sprite)) {
-            enemy->next_state = ENEMY_IDLE;
-        }
-
-        // resolve enemy collisions with each other
-        for (int i = 0; i < world->n_enemies; ++i) {
-            Enemy *enemy0 = &world->enemies[i];
-            if (enemy0->state == ENEMY_EXPLODE) continue;
-            for (int j = 0; j < world->n_enemies; ++j) {
-                if (i == j) continue;
-                Enemy *enemy1 = &world->enemies[j];
-                if (enemy1->state == ENEMY_EXPLODE) continue;
-                Vector3 v = Vector3Subtract(
-                    enemy1->transform.translation, enemy0->transform.translation
-                );
-                if (Vector3Length(v) < ENEMY_RADIUS * 2.0) {
-                    v = Vector3Scale(Vector3Normalize(v), ENEMY_RADIUS * 2.0);
-                    enemy1->transform.translation = Vector3Add(
-                        enemy0->transform.translation, v
-                    );
-                }
-            }
+            Vector3 step = Vector3Scale(dir, enemies->speed[i] * world->dt);
+            enemies->position[i] = Vector3Add(enemies->position[i], step);
+            enemies->next_state[i] = ENEMY_RUN;
+        } else if (enemies->state[i] == ENEMY_ATTACK && is_animated_sprite_finished(get_enemy_animated_sprite(enemies, i, resources))) {
+            enemies->next_state[i] = ENEMY_IDLE;
         }
 
         // rotate enemies towards the player
         if (can_attack || can_move) {
-            enemy->transform.rotation = QuaternionFromVector3ToVector3(
+            enemies->rotation[i] = QuaternionFromVector3ToVector3(
                 (Vector3){0.0, 1.0, 0.0}, (Vector3){dir.x, dir.y, 0.0}
             );
         }
     }
 
-    if (kill_enemy_idx != -1) {
-        Vector3 position = world->enemies[kill_enemy_idx].transform.translation;
+    // resolve enemy collisions with each other on the moved positions, then keep
+    // the grid up to date for the queries of the next tick
+    for (int i = 0; i < enemies->n; ++i) {
+        grid_move(grid, i, (Vector2){enemies->position[i].x, enemies->position[i].y});
+    }
+    separate_enemies(enemies, grid);
 
-        world->n_enemies -= 1;
-        world->n_enemies_killed += 1;
-        memmove(
-            &world->enemies[kill_enemy_idx],
-            &world->enemies[kill_enemy_idx + 1],
-            sizeof(Enemy) * (world->n_enemies - kill_enemy_idx)
+    for (int i = 0; i < enemies->n; ++i) {
+        grid_move(grid, i, (Vector2){enemies->position[i].x, enemies->position[i].y});
+    }
+
+    // remove enemies which finished exploding, keeping the order of the rest, the
+    // matcher and the grid follow the moved enemies
+    int n_alive_enemies = 0;
+    for (int i = 0; i < enemies->n; ++i) {
+        bool is_killed = enemies->state[i] == ENEMY_EXPLODE
+                         && is_animated_sprite_finished(
+                             get_enemy_animated_sprite(enemies, i, resources)
+                         );
+        if (!is_killed) {
+            int j = n_alive_enemies++;
+            if (i == j) continue;
+            enemies->position[j] = enemies->position[i];
+            enemies->impulse_direction[j] = enemies->impulse_direction[i];
+            enemies->impulse_speed[j] = enemies->impulse_speed[i];
+            enemies->impulse_deceleration[j] = enemies->impulse_deceleration[i];
+            enemies->speed[j] = enemies->speed[i];
+            enemies->recent_attack_time[j] = enemies->recent_attack_time[i];
+            enemies->sprite_time[j] = enemies->sprite_time[i];
+            enemies->state[j] = enemies->state[i];
+            enemies->next_state[j] = enemies->next_state[i];
+            enemies->prev_position[j] = enemies->prev_position[i];
+            enemies->rotation[j] = enemies->rotation[i];
+            enemies->prev_rotation[j] = enemies->prev_rotation[i];
+            strcpy(enemies->name[j], enemies->name[i]);
+            matcher_move(matcher, ENEMY_TARGET(i), ENEMY_TARGET(j));
+            grid_rename(grid, i, j);
+            continue;
+        }
+
+        push_event(
+            world, (Event){.type = EVENT_ENEMY_KILLED, .position = enemies->position[i]}
         );
+        matcher_remove(matcher, ENEMY_TARGET(i));
+        grid_remove(grid, i);
 
-        float p = frand_01();
+        float p = rng_float(&world->rng);
         if (DROP_PROBABILITY >= p && world->n_drops < MAX_N_DROPS) {
-            int idx = GetRandomValue(0, N_DROPS - 1);
+            int idx = rng_int(&world->rng, 0, N_DROPS - 1);
             Drop drop = {0};
-            drop.position = position;
+            drop.position = enemies->position[i];
             drop.time = DROP_DURATION;
             if (idx == DROP_HEAL) {
                 drop.type = DROP_HEAL;
@@ -1014,12 +2428,147 @@ static void update_enemies(World *world, Resources *resources) {
         }
     }
 
-    // sort enemies
-    qsort(world->enemies, world->n_enemies, sizeof(Enemy), sort_enemies);
+    enemies->n = n_alive_enemies;
+}
+
+// Pushes both enemies of every overlapping pair apart. The positions are gathered
+// cell by cell, a column of the grid after the other, so the neighbours of a cell
+// lie in at most a few contiguous ranges: the rest of the cell and the one above
+// it, and the three cells of the next column. The pair tests then run over plain
+// arrays instead of chasing the bucket lists
+static void separate_enemies(Enemies *enemies, Grid *grid) {
+    int *cell_start = enemies->cell_start;
+    float *x = enemies->sorted_x;
+    float *y = enemies->sorted_y;
+
+    // a few enemies are cheaper to check pair by pair than to sort into the cells
+    if (enemies->n < MIN_N_SORTED_ENEMIES) {
+        int n = 0;
+        for (int i = 0; i < enemies->n; ++i) {
+            if (enemies->state[i] == ENEMY_EXPLODE) continue;
+            enemies->sorted[n] = i;
+            x[n] = enemies->position[i].x;
+            y[n] = enemies->position[i].y;
+            n += 1;
+        }
+        for (int i = 0; i < n; ++i) {
+            int range_start[1] = {i + 1};
+            int range_end[1] = {n};
+            separate_sorted_enemy(x, y, i, range_start, range_end, 1);
+        }
+        scatter_sorted_enemies(enemies, n);
+        return;
+    }
+
+    int n = 0;
+    for (int cx = 0; cx < GRID_SIZE; ++cx) {
+        for (int cy = 0; cy < GRID_SIZE; ++cy) {
+            cell_start[cx * GRID_SIZE + cy] = n;
+            int bucket = grid_get_bucket(cx, cy);
+            for (int i = grid->bucket_head[bucket]; i != -1; i = grid->item_next[i]) {
+                if (enemies->state[i] == ENEMY_EXPLODE) continue;
+                enemies->sorted[n] = i;
+                x[n] = enemies->position[i].x;
+                y[n] = enemies->position[i].y;
+                n += 1;
+            }
+        }
+    }
+    cell_start[GRID_SIZE * GRID_SIZE] = n;
+
+    for (int cx = 0; cx < GRID_SIZE; ++cx) {
+        for (int cy = 0; cy < GRID_SIZE; ++cy) {
+            int cell = cx * GRID_SIZE + cy;
+            if (cell_start[cell] == cell_start[cell + 1]) continue;
+
+            // the cell itself comes first, the ones which follow each other in
+            // memory are merged, which only the wrapped edge rows prevent
+            int next_cx = (cx + 1) & (GRID_SIZE - 1);
+            int pair_cells[5] = {
+                cell,
+                cx * GRID_SIZE + ((cy + 1) & (GRID_SIZE - 1)),
+                next_cx * GRID_SIZE + ((cy - 1) & (GRID_SIZE - 1)),
+                next_cx * GRID_SIZE + cy,
+                next_cx * GRID_SIZE + ((cy + 1) & (GRID_SIZE - 1)),
+            };
+            int range_start[5];
+            int range_end[5];
+            int n_ranges = 0;
+            for (int k = 0; k < 5; ++k) {
+                int pair_cell = pair_cells[k];
+                if (n_ranges > 0 && pair_cells[k - 1] + 1 == pair_cell) {
+                    range_end[n_ranges - 1] = cell_start[pair_cell + 1];
+                } else {
+                    range_start[n_ranges] = cell_start[pair_cell];
+                    range_end[n_ranges] = cell_start[pair_cell + 1];
+                    n_ranges += 1;
+                }
+            }
+
+            for (int i = cell_start[cell]; i < cell_start[cell + 1]; ++i) {
+                range_start[0] = i + 1;
+                separate_sorted_enemy(x, y, i, range_start, range_end, n_ranges);
+            }
+        }
+    }
+
+    scatter_sorted_enemies(enemies, n);
+}
+
+// Pushes the sorted enemy i and the ones of the ranges apart where they overlap.
+// The push is computed for every pair, pairs which don't overlap get a zero one:
+// about a third of the neighbours overlap in a packed horde, a branch on it would
+// be mispredicted all the time
+static void separate_sorted_enemy(
+    float *x, float *y, int i, const int *range_start, const int *range_end, int n_ranges
+) {
+    float min_dist = ENEMY_RADIUS * 2.0;
+    float xi = x[i];
+    float yi = y[i];
+    float push_xi = 0.0;
+    float push_yi = 0.0;
+    for (int k = 0; k < n_ranges; ++k) {
+        for (int j = range_start[k]; j < range_end[k]; ++j) {
+            float dx = x[j] - xi;
+            float dy = y[j] - yi;
+            float dist_sqr = dx * dx + dy * dy;
+
+            // coincident enemies are split along x
+            if (dist_sqr == 0.0f) {
+                dx = EPSILON;
+                dist_sqr = EPSILON * EPSILON;
+            }
+
+            float dist = sqrtf(dist_sqr);
+            float scale = fmaxf(min_dist - dist, 0.0f) * 0.5f / dist;
+            push_xi += dx * scale;
+            push_yi += dy * scale;
+            x[j] += dx * scale;
+            y[j] += dy * scale;
+        }
+    }
+    x[i] -= push_xi;
+    y[i] -= push_yi;
+}
+
+static void scatter_sorted_enemies(Enemies *enemies, int n) {
+    for (int k = 0; k < n; ++k) {
+        int i = enemies->sorted[k];
+        enemies->position[i].x = enemies->sorted_x[k];
+        enemies->position[i].y = enemies->sorted_y[k];
+    }
 }
 
-static void update_drops(World *world, Resources *resources) {
+// The draw order depends only on the match counts and the set of enemies, so
+// it's rebuilt only when the matcher reports a change of any of them
+static void update_enemies_order(World *world) {
+    if (!world->matcher.is_changed) return;
 
+    sort_enemies(&world->enemies, &world->matcher);
+    world->matcher.is_changed = false;
+}
+
+static void update_drops(World *world) {
     Vector3 player_position = world->player.transform.translation;
 
     int n_alive_drops = 0;
@@ -1037,7 +2586,12 @@ static void update_drops(World *world, Resources *resources) {
                         command->time = command->cooldown;
                     }
                 }
-                play_sounds_roulette(&resources->pickup_sounds, 1.0);
+                push_event(
+                    world,
+                    (Event){.type = EVENT_DROP_PICKED,
+                            .position = drop->position,
+                            .drop.type = drop->type}
+                );
             } else {
                 world->drops[n_alive_drops++] = *drop;
             }
@@ -1055,30 +2609,10 @@ static void update_player(World *world, Resources *resources) {
     // apply player next state
     if (player->state != player->next_state && player->state != PLAYER_DEATH) {
         player->state = player->next_state;
-        if (player->state == PLAYER_IDLE) {
-            player->animated_sprite = get_animated_sprite(
-                resources->player_idle_texture, true
-            );
-        } else if (player->state == PLAYER_RUN) {
-            player->animated_sprite = get_animated_sprite(
-                resources->player_run_texture, true
-            );
-        } else if (player->state == PLAYER_SHOOT) {
-            player->animated_sprite = get_animated_sprite(
-                resources->player_shoot_texture, false
-            );
-        } else if (player->state == PLAYER_HURT) {
-            player->animated_sprite = get_animated_sprite(
-                resources->player_hurt_texture, false
-            );
-        } else if (player->state == PLAYER_DEATH) {
-            player->animated_sprite = get_animated_sprite(
-                resources->player_death_texture, false
-            );
-        }
+        player->animated_sprite = resources->player_sprites[player->state];
     }
 
-    if (player->health <= 0.0) {
+    if (player->health <= 0.0 && !player->is_invulnerable) {
         if (player->state != PLAYER_DEATH) {
             player->next_state = PLAYER_DEATH;
         } else if (is_animated_sprite_finished(player->animated_sprite)) {
@@ -1088,10 +2622,11 @@ static void update_player(World *world, Resources *resources) {
         return;
     }
 
-    bool is_just_shot = world->shot.time == 0.0 && world->shot.trace_duration > 0.0;
-    if (is_just_shot) {
+    // faces the last enemy shot in this tick
+    const Event *shot = find_last_event(&world->events, EVENT_ENEMY_SHOT);
+    if (shot) {
         Vector3 dir = Vector3Normalize(
-            Vector3Subtract(world->shot.end_position, world->shot.start_position)
+            Vector3Subtract(shot->position, shot->shot.origin)
         );
         player->transform.rotation = QuaternionFromVector3ToVector3(
             (Vector3){0.0, 1.0, 0.0}, (Vector3){dir.x, dir.y, 0.0}
@@ -1100,10 +2635,10 @@ static void update_player(World *world, Resources *resources) {
     }
 
     Vector2 dir = Vector2Zero();
-    dir.y += IsKeyDown(KEY_UP);
-    dir.y -= IsKeyDown(KEY_DOWN);
-    dir.x -= IsKeyDown(KEY_LEFT);
-    dir.x += IsKeyDown(KEY_RIGHT);
+    dir.y += world->input.is_up_down;
+    dir.y -= world->input.is_down_down;
+    dir.x -= world->input.is_left_down;
+    dir.x += world->input.is_right_down;
 
     if (Vector2Length(dir) >= EPSILON && world->state != STATE_PAUSE) {
         dir = Vector2Normalize(dir);
@@ -1114,13 +2649,19 @@ static void update_player(World *world, Resources *resources) {
         position.y += step.y;
 
         // resolve collision with enemies
-        for (int i = 0; i < world->n_enemies; ++i) {
-            Enemy *enemy = &world->enemies[i];
-            if (enemy->state == ENEMY_EXPLODE) continue;
-            Vector3 v = Vector3Subtract(position, enemy->transform.translation);
+        Enemies *enemies = &world->enemies;
+        GridQuery query = grid_query(
+            &world->enemies_grid,
+            (Vector2){position.x, position.y},
+            ENEMY_RADIUS + PLAYER_RADIUS
+        );
+        int i;
+        while (grid_query_next(&query, &i)) {
+            if (enemies->state[i] == ENEMY_EXPLODE) continue;
+            Vector3 v = Vector3Subtract(position, enemies->position[i]);
             if (Vector3Length(v) < ENEMY_RADIUS + PLAYER_RADIUS) {
                 v = Vector3Scale(Vector3Normalize(v), ENEMY_RADIUS + PLAYER_RADIUS);
-                position = Vector3Add(enemy->transform.translation, v);
+                position = Vector3Add(enemies->position[i], v);
             }
         }
 
@@ -1136,7 +2677,7 @@ static void update_player(World *world, Resources *resources) {
 
         if (player->step_time >= PLAYER_STEP_PERIOD) {
             player->step_time = 0.0;
-            play_sounds_roulette_rnd(&resources->player_step_sounds, 0.4);
+            push_event(world, (Event){.type = EVENT_PLAYER_STEP, .position = position});
         }
         player->step_time += world->dt;
 
@@ -1148,18 +2689,18 @@ static void update_player(World *world, Resources *resources) {
         // damage player if submitted command doesn't exist
         if (world->submit_word[0] != '\0' && !world->is_command_matched) {
             world->player.health -= WRONG_COMMAND_DAMAGE;
-            world->camera_shake = (CameraShake
-            ){.time = 0.0,
-              .duration = CAMERA_SHAKE_TIME,
-              .strength = WRONG_COMMAND_DAMAGE};
             player->next_state = PLAYER_HURT;
-            play_sounds_roulette(&resources->error_sounds, 1.0);
+            push_event(
+                world,
+                (Event){.type = EVENT_PLAYER_HIT,
+                        .position = player->transform.translation,
+                        .hit.damage = WRONG_COMMAND_DAMAGE}
+            );
         }
 
         // damage player if backspace is pressed
         int prompt_len = strlen(world->prompt);
-        if ((IsKeyPressed(KEY_BACKSPACE) || IsKeyPressedRepeat(KEY_BACKSPACE))
-            && prompt_len > 0) {
+        if (world->input.is_backspace_pressed && prompt_len > 0) {
             world->player.health -= BACKSPACE_DAMAGE;
         }
     }
@@ -1172,35 +2713,86 @@ static void update_player(World *world, Resources *resources) {
 }
 
 static void update_audio(World *world, Resources *resources) {
-    // update roar (background)
+    VoicePool *voices = &resources->voices;
+    play_event_sounds(world, resources);
+
+    // running enemies growl, the mixer places each of them around the player
+    Vector3 player_position = world->player.transform.translation;
+    Vector3 horde_direction = {0};
+    AudioListener *listener = get_audio_listener(&resources->audio);
+    listener->position = player_position;
+    listener->n_sources = 0;
+    if (world->state == STATE_PLAYING) {
+        Enemies *enemies = &world->enemies;
+        for (int i = 0; i < enemies->n; ++i) {
+            if (listener->n_sources == MAX_N_AUDIO_SOURCES) break;
+            if (enemies->state[i] == ENEMY_RUN) {
+                listener->sources[listener->n_sources++] = enemies->position[i];
+                Vector3 v = Vector3Subtract(enemies->position[i], player_position);
+                horde_direction = Vector3Add(horde_direction, v);
+            }
+        }
+    }
+    publish_audio_listener(&resources->audio);
+
+    // update roar (background), it comes from where the horde runs from
     if (world->roar_time <= 0.0 && world->time > MIN_ROAR_PERIOD) {
-        play_sounds_roulette_rnd(&resources->roar_sounds, 0.4);
-        world->roar_time = frand_range(MIN_ROAR_PERIOD, MAX_ROAR_PERIOD);
+        Rng *rng = &world->cosmetic_rng;
+        Vector3 horde_position = Vector3Add(player_position, horde_direction);
+        float pan = get_audio_pan(player_position, horde_position);
+        play_sounds_roulette_rnd(voices, &resources->roar_sounds, rng, 0.4, pan);
+        world->roar_time = rng_range(rng, MIN_ROAR_PERIOD, MAX_ROAR_PERIOD);
     }
     world->roar_time -= world->dt;
+}
 
-    // update growling
-    float vol = 0.0;
-    if (world->state == STATE_PLAYING) {
-        float max_d = SPAWN_RADIUS * 2.0;
-        for (int i = 0; i < world->n_enemies; ++i) {
-            Enemy *enemy = &world->enemies[i];
-            if (enemy->state == ENEMY_RUN) {
-                float d = Vector3Distance(
-                    enemy->transform.translation, world->player.transform.translation
-                );
-
-                if (d < max_d) {
-                    d = (max_d - d) / max_d;
-                    d = d * d;
-                    vol += d * 0.2;
-                }
+static void play_event_sounds(World *world, Resources *resources) {
+    VoicePool *voices = &resources->voices;
+    Rng *rng = &world->cosmetic_rng;
+    Vector3 player_position = world->player.transform.translation;
+    const Events *events = &world->events;
+    for (int i = get_first_event(events); i < events->n; ++i) {
+        const Event *event = get_event(events, i);
+        if (event->type == EVENT_ENEMY_SHOT) {
+            play_sounds_roulette(voices, &resources->shot_sounds, 1.0);
+            play_sounds_roulette(voices, &resources->enemy_death_sounds, 1.0);
+        } else if (event->type == EVENT_PLAYER_HIT && event->hit.is_attack) {
+            float pan = get_audio_pan(player_position, event->position);
+            SoundsRoulette *attack_sounds = &resources->enemy_attack_sounds;
+            play_sounds_roulette_rnd(voices, attack_sounds, rng, 1.0, pan);
+            play_sounds_roulette_rnd(voices, &resources->bite_sounds, rng, 1.0, pan);
+        } else if (event->type == EVENT_PLAYER_HIT) {
+            play_sounds_roulette(voices, &resources->error_sounds, 1.0);
+        } else if (event->type == EVENT_PLAYER_STEP) {
+            SoundsRoulette *step_sounds = &resources->player_step_sounds;
+            play_sounds_roulette_rnd(voices, step_sounds, rng, 0.4, MIXER_PAN_CENTER);
+        } else if (event->type == EVENT_DROP_PICKED) {
+            play_sounds_roulette(voices, &resources->pickup_sounds, 1.0);
+        } else if (event->type == EVENT_COMMAND_FIRED) {
+            SoundsRoulette *sounds = NULL;
+            if (event->command.type == COMMAND_PAUSE) {
+                sounds = &resources->pause_sounds;
+            } else if (event->command.type == COMMAND_CRYONICS) {
+                sounds = event->command.is_stop ? &resources->unfreeze_sounds
+                                                : &resources->cryonics_sounds;
+            } else if (event->command.type == COMMAND_REPULSE) {
+                sounds = &resources->repulse_sounds;
+            } else if (event->command.type == COMMAND_DECAY) {
+                sounds = &resources->decay_sounds;
             }
+            if (sounds) play_sounds_roulette(voices, sounds, 1.0);
         }
+    }
+}
 
-        vol = min(1.0, vol);
+// Simulation consumer: the counters of the game over screen and the batch runs
+static void update_stats(World *world) {
+    const Events *events = &world->events;
+    for (int i = get_first_event(events); i < events->n; ++i) {
+        if (get_event(events, i)->type == EVENT_ENEMY_KILLED) {
+            world->n_enemies_killed += 1;
+        }
     }
-    SetMusicVolume(resources->growling_music, vol);
 }
 
 static void update_camera(World *world) {
@@ -1208,9 +2800,23 @@ static void update_camera(World *world) {
     CameraShake *shake = &world->camera_shake;
     camera->position = CAMERA_INIT_POSITION;
 
+    // the hardest hit of the tick shakes the camera, as a single hit always did
+    float strength = 0.0;
+    const Events *events = &world->events;
+    for (int i = get_first_event(events); i < events->n; ++i) {
+        const Event *event = get_event(events, i);
+        if (event->type == EVENT_PLAYER_HIT) {
+            strength = fmaxf(strength, event->hit.damage);
+        }
+    }
+    if (strength > 0.0) {
+        *shake = (CameraShake){
+            .time = 0.0, .duration = CAMERA_SHAKE_TIME, .strength = strength};
+    }
+
     if (shake->time <= shake->duration && world->state == STATE_PLAYING) {
-        float x_shake = frand_centered();
-        float y_shake = frand_centered();
+        float x_shake = rng_centered(&world->cosmetic_rng);
+        float y_shake = rng_centered(&world->cosmetic_rng);
         float k = shake->time / shake->duration;
         x_shake *= k * shake->strength * 0.001;
         y_shake *= k * shake->strength * 0.001;
@@ -1222,37 +2828,106 @@ static void update_camera(World *world) {
     }
 }
 
+// Every shot of the tick leaves a trace, the oldest one makes room for it
+static void update_vfx(World *world) {
+    int n_alive_shots = 0;
+    for (int i = 0; i < world->n_shots; ++i) {
+        Shot *shot = &world->shots[i];
+        shot->time += world->dt;
+        if (shot->time < shot->trace_duration) world->shots[n_alive_shots++] = *shot;
+    }
+    world->n_shots = n_alive_shots;
+
+    const Events *events = &world->events;
+    for (int i = get_first_event(events); i < events->n; ++i) {
+        const Event *event = get_event(events, i);
+        if (event->type != EVENT_ENEMY_SHOT) continue;
+
+        if (world->n_shots == MAX_N_SHOTS) {
+            world->n_shots -= 1;
+            memmove(world->shots, world->shots + 1, world->n_shots * sizeof(Shot));
+        }
+        world->shots[world->n_shots++] = (Shot){
+            .time = 0.0,
+            .trace_duration = SHOT_TRACE_DURATION,
+            .start_position = event->shot.origin,
+            .end_position = event->position,
+        };
+    }
+}
+
+static void push_event(World *world, Event event) {
+    Events *events = &world->events;
+    events->ring[events->n++ & (MAX_N_EVENTS - 1)] = event;
+}
+
+static void push_command_event(World *world, CommandType type, bool is_stop) {
+    push_event(world, (Event){.type = EVENT_COMMAND_FIRED, .command = {type, is_stop}});
+}
+
+// Events of the tick are [get_first_event, n), the older ones are overwritten
+static int get_first_event(const Events *events) {
+    return events->n > MAX_N_EVENTS ? events->n - MAX_N_EVENTS : 0;
+}
+
+static const Event *get_event(const Events *events, int i) {
+    return &events->ring[i & (MAX_N_EVENTS - 1)];
+}
+
+static const Event *find_last_event(const Events *events, EventType type) {
+    for (int i = events->n - 1; i >= get_first_event(events); --i) {
+        const Event *event = get_event(events, i);
+        if (event->type == type) return event;
+    }
+    return NULL;
+}
+
+// Typed characters per minute of the game time, discounted by the accuracy
+static void get_typing_stats(const World *world, float *accuracy, float *cpm) {
+    *accuracy = 1.0;
+    *cpm = 0.0;
+    if (world->n_keystrokes_typed > 0 && world->time > 0.0) {
+        *accuracy = 1.0 - (float)world->n_backspaces_typed / world->n_keystrokes_typed;
+        *cpm = *accuracy * world->n_keystrokes_typed * 60.0 / world->time;
+    }
+}
+
+// the frame itself is picked by sprite.vert, see push_animated_sprite
 static void update_animated_sprite(AnimatedSprite *animated_sprite, float dt) {
     animated_sprite->time += dt;
-    float frame_duration = 1.0 / animated_sprite->fps;
-    animated_sprite->frame_idx = animated_sprite->time / frame_duration;
-    if (animated_sprite->frame_idx >= animated_sprite->n_frames
-        && animated_sprite->is_repeat) {
-        animated_sprite->frame_idx %= animated_sprite->n_frames;
-    } else {
-        animated_sprite->frame_idx = min(
-            animated_sprite->frame_idx, animated_sprite->n_frames - 1
-        );
-    }
 }
 
-static void draw_world(World *world, Resources *resources) {
+static void draw_world(World *world, Resources *resources, float alpha) {
+    Profiler *profiler = resources->profiler;
+    double zone_start = begin_profile_zone(profiler);
+    update_ground(&resources->ground, world->spawn_radius);
+    end_profile_zone(profiler, ZONE_DRAW_GROUND_BAKE, zone_start);
+
     BeginDrawing();
     ClearBackground(BLANK);
 
     float x = 13.0;
     float w = 178.0;
+    int prompt_len = strlen(world->prompt);
+    TextCache *texts = &resources->text_cache;
     // scene
     if (world->state > STATE_MENU) {
         BeginMode3D(world->camera);
-        draw_arena(world->player.transform.translation, world->spawn_radius, resources);
-
-        // draw player
-        draw_animated_sprite(
-            world->player.animated_sprite, world->player.transform, resources
+        Transform player_transform = get_interpolated_transform(
+            world->player.prev_transform, world->player.transform, alpha
+        );
+        zone_start = begin_profile_zone(profiler);
+        draw_arena(player_transform.translation, resources);
+        end_profile_zone(profiler, ZONE_DRAW_ARENA, zone_start);
+
+        // player and enemies are pushed into the sprite batch and drawn at once
+        SpriteBatch *batch = &resources->sprite_batch;
+        push_animated_sprite(
+            batch, world->player.animated_sprite, player_transform, world->time
         );
 
         // draw drops
+        zone_start = begin_profile_zone(profiler);
         for (int i = 0; i < world->n_drops; ++i) {
             Drop drop = world->drops[i];
             float a = fmodf(world->time * 180.0, 360.0);
@@ -1273,24 +2948,39 @@ static void draw_world(World *world, Resources *resources) {
             }
             rlPopMatrix();
         }
+        end_profile_zone(profiler, ZONE_DRAW_DROPS, zone_start);
 
         // draw enemies
-        for (int i = 0; i < world->n_enemies; ++i) {
-            Enemy enemy = world->enemies[i];
-            if (Vector3Length(enemy.transform.translation) <= world->spawn_radius) {
-                draw_animated_sprite(enemy.animated_sprite, enemy.transform, resources);
+        zone_start = begin_profile_zone(profiler);
+        Enemies *enemies = &world->enemies;
+        for (int k = 0; k < enemies->n; ++k) {
+            int i = enemies->order[k];
+            Transform transform = {
+                .translation = Vector3Lerp(
+                    enemies->prev_position[i], enemies->position[i], alpha
+                ),
+                .rotation = QuaternionSlerp(
+                    enemies->prev_rotation[i], enemies->rotation[i], alpha
+                ),
+                .scale = Vector3One(),
+            };
+            if (Vector3Length(transform.translation) <= world->spawn_radius) {
+                AnimatedSprite sprite = get_enemy_animated_sprite(enemies, i, resources);
+                push_animated_sprite(batch, sprite, transform, world->time);
             }
         }
+        draw_sprite_batch(batch, world->time);
+        end_profile_zone(profiler, ZONE_DRAW_SPRITES, zone_start);
 
-        // draw shot
-        Shot *shot = &world->shot;
-        if (shot->time < shot->trace_duration) {
+        // draw shots
+        for (int i = 0; i < world->n_shots; ++i) {
+            Shot *shot = &world->shots[i];
             Vector3 a = shot->start_position;
             Vector3 b = shot->end_position;
             Vector3 d = Vector3Normalize(Vector3Subtract(b, a));
             a = Vector3Add(a, Vector3Scale(d, 2.0));
             float alpha = 1.0 - shot->time / shot->trace_duration;
-            Color color = {255, 240, 50};
+            Color color = {255, 240, 50, 255};
             DrawCylinderEx(a, b, 0.2, 0.4, 8, ColorAlpha(color, alpha));
         }
 
@@ -1298,20 +2988,19 @@ static void draw_world(World *world, Resources *resources) {
 
         if (world->state < STATE_GAME_OVER) {
             // draw enemy names
-            for (int i = 0; i < world->n_enemies; ++i) {
-                Enemy enemy = world->enemies[i];
-                if (enemy.state == ENEMY_EXPLODE
-                    || Vector3Length(enemy.transform.translation) > world->spawn_radius)
+            zone_start = begin_profile_zone(profiler);
+            for (int k = 0; k < enemies->n; ++k) {
+                int i = enemies->order[k];
+                Vector3 position = Vector3Lerp(
+                    enemies->prev_position[i], enemies->position[i], alpha
+                );
+                if (enemies->state[i] == ENEMY_EXPLODE
+                    || Vector3Length(position) > world->spawn_radius)
                     continue;
 
-                Vector2 screen_pos = GetWorldToScreen(
-                    enemy.transform.translation, world->camera
-                );
-                Vector2 text_size = MeasureTextEx(
-                    resources->command_font,
-                    enemy.name,
-                    resources->command_font.baseSize,
-                    0
+                Vector2 screen_pos = GetWorldToScreen(position, world->camera);
+                Vector2 text_size = measure_text(
+                    texts, resources->command_font, enemies->name[i]
                 );
 
                 Vector2 rec_size = Vector2Scale(text_size, 1.2);
@@ -1325,11 +3014,22 @@ static void draw_world(World *world, Resources *resources) {
                     rec_center.x - 0.5 * text_size.x,
                     rec_center.y - 0.5 * resources->command_font.baseSize};
 
-                DrawRectangleRounded(rec, 0.3, 16, (Color){20, 20, 20, 190});
-                draw_text(resources->command_font, enemy.name, text_pos, world->prompt);
+                // queued with the text, so each label covers the ones behind it
+                push_rect(texts, resources->command_font, rec, (Color){20, 20, 20, 190});
+                push_text(
+                    texts,
+                    resources->command_font,
+                    enemies->name[i],
+                    text_pos,
+                    matcher_get_n_matched(&world->matcher, ENEMY_TARGET(i)),
+                    prompt_len
+                );
             }
+            draw_text_batch(texts);
+            end_profile_zone(profiler, ZONE_DRAW_LABELS, zone_start);
 
             // commands pane
+            zone_start = begin_profile_zone(profiler);
             float aspect = (float)resources->commands_pane_texture.width
                            / resources->commands_pane_texture.height;
             Rectangle rec = {2.0, 2.0, 580 * aspect, 580.0};
@@ -1358,11 +3058,10 @@ static void draw_world(World *world, Resources *resources) {
             rec.width *= ratio;
             DrawRectangleRounded(rec, 0.5, 16, color);
 
-            DrawTextureEx(
-                resources->health_icon_texture,
+            DrawTextureRec(
+                resources->atlas.texture,
+                resources->health_icon,
                 (Vector2){rec.x, rec.y - 10.0},
-                0.0,
-                1.0,
                 WHITE
             );
 
@@ -1383,62 +3082,75 @@ static void draw_world(World *world, Resources *resources) {
             rec.width *= ratio;
             DrawRectangleRounded(rec, 0.5, 16, color);
 
-            DrawTextureEx(
-                resources->enemy_icon_texture,
+            DrawTextureRec(
+                resources->atlas.texture,
+                resources->enemy_icon,
                 (Vector2){rec.x, rec.y - 10.0},
-                0.0,
-                1.0,
                 WHITE
             );
+            end_profile_zone(profiler, ZONE_DRAW_PANE, zone_start);
         }
 
-        float accuracy = 1.0;
-        int cpm = 0;
-        if (world->n_keystrokes_typed > 0) {
-            accuracy = 1.0 - (float)world->n_backspaces_typed / world->n_keystrokes_typed;
-            cpm = accuracy * world->n_keystrokes_typed * 60.0 / world->time;
-        }
+        float accuracy, cpm;
+        get_typing_stats(world, &accuracy, &cpm);
 
         int y = 448;
-        draw_text(
+        push_text(
+            texts,
             resources->stats_font,
             TextFormat("Kills: %d", world->n_enemies_killed),
             (Vector2){x, y},
+            0,
             0
         );
 
         y += resources->stats_font.baseSize;
-        draw_text(
+        push_text(
+            texts,
             resources->stats_font,
             TextFormat("Play time: %d s", (int)world->time),
             (Vector2){x, y},
+            0,
             0
         );
 
         y += resources->stats_font.baseSize;
-        draw_text(
+        push_text(
+            texts,
             resources->stats_font,
             TextFormat("Keystrokes: %d", (int)world->n_keystrokes_typed),
             (Vector2){x, y},
+            0,
             0
         );
 
         y += resources->stats_font.baseSize;
-        draw_text(resources->stats_font, TextFormat("CPM: %d", cpm), (Vector2){x, y}, 0);
+        push_text(
+            texts,
+            resources->stats_font,
+            TextFormat("CPM: %d", (int)cpm),
+            (Vector2){x, y},
+            0,
+            0
+        );
 
         y += resources->stats_font.baseSize;
-        draw_text(
+        push_text(
+            texts,
             resources->stats_font,
             TextFormat("Accuracy: %.2f", accuracy),
             (Vector2){x, y},
+            0,
             0
         );
 
         y += resources->stats_font.baseSize;
-        draw_text(
+        push_text(
+            texts,
             resources->stats_font,
             TextFormat("Difficulty: %s", world->difficulty_str),
             (Vector2){x, y},
+            0,
             0
         );
     } else {
@@ -1446,18 +3158,24 @@ static void draw_world(World *world, Resources *resources) {
         float t = GetTime() * 0.3;
         float r = world->spawn_radius * 0.6 * (sinf(t * 3.0) + 1.0) * 0.5;
         Vector3 pos = {r * cosf(t), r * sinf(t), 0.0};
-        draw_arena(pos, world->spawn_radius, resources);
+        zone_start = begin_profile_zone(profiler);
+        draw_arena(pos, resources);
+        end_profile_zone(profiler, ZONE_DRAW_ARENA, zone_start);
         EndMode3D();
     }
 
     // draw commands
+    zone_start = begin_profile_zone(profiler);
     int n = 0;
     for (int i = 0; i < world->n_commands; ++i) {
         Command *command = &world->commands[i];
         float y = 40.0 + 1.8 * (n++) * resources->command_font.baseSize;
 
+        // a command waiting for its resources shows the loading progress instead
+        bool is_resident = !(command->required_resources & ~resources->resident_mask);
         float ratio;
         ratio = fminf(1.0, command->time / command->cooldown);
+        if (!is_resident) ratio = get_loading_progress(resources);
         Color color = ColorFromNormalized((Vector4){
             .x = 1.0 - ratio,
             .y = ratio,
@@ -1475,8 +3193,8 @@ static void draw_world(World *world, Resources *resources) {
         }
 
         float text_x = x;
-        if (IsTextureReady(command->icon_texture)) {
-            text_x += command->icon_texture.width + 2.0;
+        if (command->icon.width > 0) {
+            text_x += command->icon.width + 2.0;
             float alpha = 1.0;
             if (ratio < 1.0 - EPSILON) {
                 float min_alpha = 0.2;
@@ -1484,32 +3202,38 @@ static void draw_world(World *world, Resources *resources) {
                 alpha = ((sinf(GetTime() * 8.0) + 1.0) / 2.0) * (max_alpha - min_alpha)
                         + min_alpha;
             }
-            DrawTextureEx(
-                command->icon_texture,
+            DrawTextureRec(
+                resources->atlas.texture,
+                command->icon,
                 (Vector2){x - 2.0, y - 4.0},
-                0.0,
-                1.0,
                 ColorAlpha(GREEN, alpha)
             );
         }
 
-        draw_text(
-            resources->command_font, command->name, (Vector2){text_x, y}, world->prompt
+        push_text(
+            texts,
+            resources->command_font,
+            command->name,
+            (Vector2){text_x, y},
+            matcher_get_n_matched(&world->matcher, COMMAND_TARGET(i)),
+            prompt_len
         );
 
         // draw command cooldown progress bar
-        if (command->show_cooldown) {
+        if (command->show_cooldown || !is_resident) {
             float width = w * ratio;
             Rectangle rec = {x, y + resources->command_font.baseSize, width, 5.0};
             DrawRectangleRec(rec, color);
         }
     }
+    end_profile_zone(profiler, ZONE_DRAW_COMMANDS, zone_start);
 
     // draw prompt
+    zone_start = begin_profile_zone(profiler);
     static char prompt[3] = {'>', ' ', '\0'};
     Font font = resources->command_font;
-    Vector2 prompt_size = MeasureTextEx(font, prompt, font.baseSize, 0);
-    Vector2 text_size = MeasureTextEx(font, world->prompt, font.baseSize, 0);
+    Vector2 prompt_size = measure_text(texts, font, prompt);
+    Vector2 text_size = measure_text(texts, font, world->prompt);
     float y = GetScreenHeight() - font.baseSize - 5;
     DrawRectangle(
         5.0 + prompt_size.x + text_size.x,
@@ -1518,196 +3242,178 @@ static void draw_world(World *world, Resources *resources) {
         font.baseSize,
         WHITE
     );
-    draw_text(font, prompt, (Vector2){5.0, y}, 0);
-    draw_text(font, world->prompt, (Vector2){prompt_size.x, y}, 0);
+    push_text(texts, font, prompt, (Vector2){5.0, y}, 0, 0);
+    push_text(texts, font, world->prompt, (Vector2){prompt_size.x, y}, 0, 0);
 
+    // stats, commands and the prompt
+    draw_text_batch(texts);
+    end_profile_zone(profiler, ZONE_DRAW_PROMPT, zone_start);
+
+    if (profiler) draw_profiler(profiler, (Vector2){GetScreenWidth() - 310.0, 10.0});
+
+    zone_start = begin_profile_zone(profiler);
     EndDrawing();
+    end_profile_zone(profiler, ZONE_PRESENT, zone_start);
 }
 
-static void draw_arena(Vector3 light_pos, float radius, Resources *resources) {
-    float light_pos_f[2] = {light_pos.x, light_pos.y};
-    SetShaderValue(
-        resources->ground_shader,
-        GetShaderLocation(resources->ground_shader, "u_light_pos"),
-        light_pos_f,
-        SHADER_UNIFORM_VEC2
-    );
-    SetShaderValue(
-        resources->ground_shader,
-        GetShaderLocation(resources->ground_shader, "u_radius"),
-        &radius,
-        SHADER_UNIFORM_FLOAT
-    );
-    BeginShaderMode(resources->ground_shader);
-    DrawCylinderEx(
-        (Vector3){0.0, 0.0, -1.0}, (Vector3){0.0, 0.0, -0.1}, radius, radius, 64, WHITE
-    );
-    EndShaderMode();
+static void draw_arena(Vector3 light_pos, Resources *resources) {
+    draw_ground(&resources->ground, (Vector2){light_pos.x, light_pos.y});
 }
 
-static void draw_text(
-    Font font, const char *text, Vector2 position, const char *match_prompt
+// time is the world time, the sprite started playing animated_sprite.time ago
+static void push_animated_sprite(
+    SpriteBatch *batch, AnimatedSprite animated_sprite, Transform transform, float time
 ) {
-    int n_chars = strlen(text);
-    float offset = 0.0f;
-    float scale = (float)font.baseSize / font.baseSize;
-
-    int prompt_len = match_prompt != 0 ? strlen(match_prompt) : 0;
-    bool is_combo = prompt_len > 0;
-
-    for (int i = 0; i < n_chars; i++) {
-        int ch = text[i];
-        is_combo = is_combo && match_prompt[i] != '\0' && match_prompt[i] == ch;
-
-        Color color;
-        if (is_combo) {
-            color = GREEN;
-        } else if (i < prompt_len) {
-            color = RED;
-        } else {
-            color = WHITE;
-        }
-
-        if (ch != ' ') {
-            DrawTextCodepoint(
-                font, ch, (Vector2){position.x + offset, position.y}, font.baseSize, color
-            );
-        }
-
-        int index = GetGlyphIndex(font, ch);
-        if (font.glyphs[index].advanceX == 0) {
-            offset += ((float)font.recs[index].width * scale);
-        } else {
-            offset += ((float)font.glyphs[index].advanceX * scale);
+    // sprites only turn around z, so the quaternion reduces to one angle
+    Quaternion q = transform.rotation;
+    float angle = 2.0 * atan2f(q.z, q.w);
+
+    Rectangle region = animated_sprite.region;
+    push_sprite(
+        batch,
+        (SpriteInstance){
+            .position = {transform.translation.x, transform.translation.y, 0.0, angle},
+            .region = {region.x, region.y, animated_sprite.frame_width, region.height},
+            .animation = {
+                animated_sprite.n_frames,
+                animated_sprite.fps,
+                time - animated_sprite.time,
+                animated_sprite.is_repeat,
+            },
+            .color = WHITE,
         }
-    }
+    );
 }
 
-static void draw_sprite_2d(Texture2D texture, Vector2 position, Resources *resources) {
-    int loc = GetShaderLocation(resources->sprite_material.shader, "src");
-    float src[4] = {0.0, 0.0, texture.width, texture.height};
-    SetShaderValue(resources->sprite_material.shader, loc, src, SHADER_UNIFORM_VEC4);
-    resources->sprite_material.maps[0].texture = texture;
-
-    rlPushMatrix();
-    rlTranslatef(position.x, position.y, 0.0);
-    DrawMesh(resources->sprite_plane, resources->sprite_material, MatrixIdentity());
-    rlPopMatrix();
+static Transform get_interpolated_transform(Transform prev, Transform curr, float alpha) {
+    Transform transform = curr;
+    transform.translation = Vector3Lerp(prev.translation, curr.translation, alpha);
+    transform.rotation = QuaternionSlerp(prev.rotation, curr.rotation, alpha);
+    return transform;
 }
 
-static void draw_animated_sprite(
-    AnimatedSprite animated_sprite, Transform transform, Resources *resources
-) {
-    int loc = GetShaderLocation(resources->sprite_material.shader, "src");
-
-    float x = animated_sprite.frame_idx * animated_sprite.frame_width;
-
-    float src[4] = {x, 0.0, animated_sprite.frame_width, animated_sprite.texture.height};
-    SetShaderValue(resources->sprite_material.shader, loc, src, SHADER_UNIFORM_VEC4);
-    resources->sprite_material.maps[0].texture = animated_sprite.texture;
+static Texture2D load_icon(Assets *assets, const char *name) {
+    Asset *asset = get_asset(assets, TextFormat("./resources/sprites/%s.png", name));
+    return load_texture_from_asset(asset);
+}
 
-    Vector3 axis;
-    float angle;
-    QuaternionToAxisAngle(transform.rotation, &axis, &angle);
+// Everything drawn with the sprite material or as a 1:1 icon goes to the atlas
+static void load_atlas(Atlas *atlas, Assets *assets) {
+    static const char *names[] = {
+        "player_idle",
+        "player_run",
+        "player_shoot",
+        "player_hurt",
+        "player_death",
+        "enemy_idle",
+        "enemy_run",
+        "enemy_attack",
+        "enemy_freeze",
+        "enemy_explode",
+        "exit_icon",
+        "restart_icon",
+        "pause_icon",
+        "cryonics_icon",
+        "repulse_icon",
+        "decay_icon",
+        "health_icon",
+        "enemy_icon",
+    };
+    int n_names = sizeof(names) / sizeof(names[0]);
+
+    Image images[MAX_N_ATLAS_REGIONS] = {0};
+    for (int i = 0; i < n_names; ++i) {
+        const char *file_path = TextFormat("./resources/sprites/%s.png", names[i]);
+        Asset *asset = get_asset(assets, file_path);
+        if (asset != NULL) images[i] = asset->image;
+        else TraceLog(LOG_ERROR, "Sprite %s is missing", names[i]);
+    }
 
-    rlPushMatrix();
-    rlTranslatef(transform.translation.x, transform.translation.y, 0.0);
-    rlRotatef(90.0, 1.0, 0.0, 0.0);
-    rlRotatef(RAD2DEG * angle, axis.x, axis.z, axis.y);
-    DrawMesh(resources->sprite_plane, resources->sprite_material, MatrixIdentity());
-    rlPopMatrix();
+    pack_atlas(atlas, names, images, n_names);
+    if (IsWindowReady()) load_atlas_texture(atlas, images);
 }
 
-static Texture2D load_icon(const char *name) {
-    Texture2D texture = LoadTexture(TextFormat("./resources/sprites/%s.png", name));
-    return texture;
-}
+// Packed music is streamed right from the mapped pack
+static Music load_music(Assets *assets, const char *file_path) {
+    Asset *asset = get_asset(assets, file_path);
+    if (asset == NULL || asset->data == NULL) return LoadMusicStream(file_path);
 
-static Texture2D load_sprite(const char *name) {
-    Texture2D texture = LoadTexture(TextFormat("./resources/sprites/%s.png", name));
-    SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
-    return texture;
+    return LoadMusicStreamFromMemory(
+        GetFileExtension(file_path), asset->data, asset->file_size
+    );
 }
 
-static int pstrcmp(const void *a, const void *b) {
-    return strcmp(*(const char **)a, *(const char **)b);
+static void load_word_list(Words *words, Assets *assets, const char *file_path) {
+    Asset *asset = get_asset(assets, file_path);
+    if (asset == NULL || asset->data == NULL) {
+        load_words(words, file_path, MAX_WORD_LEN - 1);
+    } else {
+        load_words_from_memory(
+            words, (const char *)asset->data, asset->file_size, MAX_WORD_LEN - 1
+        );
+    }
 }
 
-static SoundsRoulette load_sounds_roulette(char *prefix) {
+// The manifest is sorted by the file path, so the sounds keep the file names order
+static SoundsRoulette load_sounds_roulette(
+    Assets *assets, VoicePool *voices, const char *prefix
+) {
     SoundsRoulette sounds = {0};
 
-    int n_file_names;
-    const char *path = "./resources/audio";
-    DIR *dir = opendir(path);
-    if (dir == NULL) {
-        TraceLog(LOG_ERROR, "Failed to open directory %s", path);
-        exit(1);
-    }
-
-    char **file_names = (char **)malloc(256 * sizeof(char *));
-
-    int i = 0;
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_type == DT_REG) {
-            file_names[i] = strdup(entry->d_name);
-            i += 1;
-        }
-    }
-
-    n_file_names = i;
-    closedir(dir);
-    qsort(file_names, n_file_names, sizeof(file_names[0]), pstrcmp);
-
-    for (int i = 0; i < n_file_names; ++i) {
+    const char *path_prefix = TextFormat("./resources/audio/%s", prefix);
+    int path_prefix_len = strlen(path_prefix);
+    for (int i = 0; i < assets->n; ++i) {
         if (sounds.n == MAX_N_ROULETTE_SOUNDS) break;
 
-        char *file_name = file_names[i];
-        if (strncmp(file_name, prefix, strlen(prefix)) == 0) {
-            const char *file_path_parts[2] = {path, file_name};
-            const char *file_path = TextJoin(file_path_parts, 2, "/");
-            sounds.sounds[sounds.n++] = LoadSound(file_path);
+        Asset *asset = &assets->assets[i];
+        if (asset->type == ASSET_WAVE
+            && strncmp(asset->file_path, path_prefix, path_prefix_len) == 0) {
+            int sample = add_voice_sample(voices, load_sound_from_asset(asset));
+            if (sample >= 0) sounds.samples[sounds.n++] = sample;
         }
     }
 
     return sounds;
 }
 
-static int sort_enemies(const void *enemy1, const void *enemy2) {
-    int n1 = ((Enemy *)enemy1)->n_matched_chars;
-    int n2 = ((Enemy *)enemy2)->n_matched_chars;
-    if (n1 > n2) return 1;
-    else if (n1 < n2) return -1;
-    else return 0;
-}
-
-static float frand_01(void) {
-    return ((float)GetRandomValue(0, RAND_MAX) / RAND_MAX);
-}
-
-static float frand_centered(void) {
-    return (frand_01() * 2.0) - 1.0;
-}
-
-static float frand_range(float left, float right) {
-    float range = right - left;
-    return left + frand_01() * range;
+// Stable counting sort of the draw order by the number of matched chars, so the
+// best matched names are drawn last (on top)
+static void sort_enemies(Enemies *enemies, Matcher *matcher) {
+    int counts[MAX_WORD_LEN + 1] = {0};
+    for (int i = 0; i < enemies->n; ++i) {
+        counts[matcher_get_n_matched(matcher, ENEMY_TARGET(i)) + 1] += 1;
+    }
+    for (int i = 1; i <= MAX_WORD_LEN; ++i) {
+        counts[i] += counts[i - 1];
+    }
+    for (int i = 0; i < enemies->n; ++i) {
+        int n_matched = matcher_get_n_matched(matcher, ENEMY_TARGET(i));
+        enemies->order[counts[n_matched]++] = i;
+    }
 }
 
-static AnimatedSprite get_animated_sprite(Texture2D texture, bool is_repeat) {
+static AnimatedSprite get_animated_sprite(Rectangle region, bool is_repeat) {
     int frame_width = 32;
     int fps = 10;
 
     AnimatedSprite sprite = {0};
     sprite.is_repeat = is_repeat;
-    sprite.texture = texture;
-    sprite.n_frames = texture.width / frame_width;
+    sprite.region = region;
+    sprite.n_frames = region.width / frame_width;
     sprite.frame_width = frame_width;
     sprite.fps = fps;
 
     return sprite;
 }
 
+static AnimatedSprite get_enemy_animated_sprite(
+    Enemies *enemies, int idx, Resources *resources
+) {
+    AnimatedSprite sprite = resources->enemy_sprites[enemies->state[idx]];
+    update_animated_sprite(&sprite, enemies->sprite_time[idx]);
+    return sprite;
+}
+
 static bool is_animated_sprite_finished(AnimatedSprite animated_sprite) {
     if (animated_sprite.is_repeat) return false;
     float frame_duration = 1.0 / animated_sprite.fps;
@@ -1715,18 +3421,17 @@ static bool is_animated_sprite_finished(AnimatedSprite animated_sprite) {
     return animated_sprite.time >= total_duration;
 }
 
-static void play_sounds_roulette(SoundsRoulette *sounds, float vol) {
+// Plays in the center, as the sounds of the player and the ui
+static void play_sounds_roulette(VoicePool *voices, SoundsRoulette *sounds, float vol) {
     if (sounds->n == 0) return;
-    Sound sound = sounds->sounds[sounds->i++];
-    SetSoundVolume(sound, vol);
-    PlaySound(sound);
+    play_voice(voices, sounds->samples[sounds->i++], vol, MIXER_PAN_CENTER);
     if (sounds->i >= sounds->n) sounds->i = 0;
 }
 
-static void play_sounds_roulette_rnd(SoundsRoulette *sounds, float vol) {
+static void play_sounds_roulette_rnd(
+    VoicePool *voices, SoundsRoulette *sounds, Rng *rng, float vol, float pan
+) {
     if (sounds->n == 0) return;
-    sounds->i = GetRandomValue(0, sounds->n - 1);
-    Sound sound = sounds->sounds[sounds->i];
-    SetSoundVolume(sound, vol);
-    PlaySound(sound);
+    sounds->i = rng_int(rng, 0, sounds->n - 1);
+    play_voice(voices, sounds->samples[sounds->i], vol, pan);
 }
@@ -1,16 +1,17 @@
 in vec2 fragTexCoord;
 in vec4 fragColor;
 
+flat in vec4 fragSrc;  // frame in the atlas: (x, y, w, h)
+
 uniform sampler2D texture0;
-uniform vec4 src;  // (x, y, w, h)
 
 out vec4 finalColor;
 
 void main() {
     vec2 tex_size = vec2(textureSize(texture0, 0));
     vec2 uv = fragTexCoord;
-    uv.x = src.x / tex_size.x + uv.x * src.z / tex_size.x;
-    uv.y = src.y / tex_size.y + uv.y * src.w / tex_size.y;
+    uv.x = fragSrc.x / tex_size.x + uv.x * fragSrc.z / tex_size.x;
+    uv.y = fragSrc.y / tex_size.y + uv.y * fragSrc.w / tex_size.y;
     uv *= tex_size;
     uv = vec2(floor(uv.x), ceil(uv.y)) + min(fract(uv) / fwidth(uv), 1.0) - 0.5;
     uv /= tex_size;
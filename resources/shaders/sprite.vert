@@ -0,0 +1,38 @@
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+
+// per instance, see SpriteInstance
+in vec4 instancePosition;   // xyz, rotation around z in w
+in vec4 instanceRegion;     // strip x, y, frame width, height
+in vec4 instanceAnimation;  // n_frames, fps, start time, is_repeat
+in vec4 instanceColor;
+
+uniform mat4 mvp;
+uniform float u_time;
+
+out vec2 fragTexCoord;
+out vec4 fragColor;
+flat out vec4 fragSrc;
+
+void main() {
+    // current frame of the strip, the same rules as update_animated_sprite
+    float n_frames = instanceAnimation.x;
+    float time = max(u_time - instanceAnimation.z, 0.0);
+    float frame = floor(time * instanceAnimation.y);
+    if (instanceAnimation.w > 0.5) frame = mod(frame, n_frames);
+    else frame = min(frame, n_frames - 1.0);
+    fragSrc = vec4(
+        instanceRegion.x + frame * instanceRegion.z, instanceRegion.y, instanceRegion.zw
+    );
+
+    // the quad is laid from xz onto the ground and rotated around z
+    float c = cos(instancePosition.w);
+    float s = sin(instancePosition.w);
+    vec2 p = vertexPosition.xz;
+    vec3 position = vec3(p.x * c + p.y * s, p.x * s - p.y * c, 0.0);
+    position += instancePosition.xyz;
+
+    fragTexCoord = vertexTexCoord;
+    fragColor = instanceColor;
+    gl_Position = mvp * vec4(position, 1.0);
+}
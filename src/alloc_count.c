@@ -0,0 +1,29 @@
+#include "alloc_count.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static atomic_long N_ALLOCS;
+
+long get_alloc_count(void) {
+    return atomic_load_explicit(&N_ALLOCS, memory_order_relaxed);
+}
+
+void *__wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&N_ALLOCS, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    atomic_fetch_add_explicit(&N_ALLOCS, 1, memory_order_relaxed);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    atomic_fetch_add_explicit(&N_ALLOCS, 1, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Number of malloc, calloc and realloc calls of the process so far. Counted only
+// in the bench build, which links with -Wl,--wrap for these functions
+long get_alloc_count(void);
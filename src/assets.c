@@ -0,0 +1,347 @@
+#include "assets.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#if !defined(PLATFORM_WEB)
+#include <unistd.h>
+#endif
+
+// same as raylib's LoadFontEx
+#define FONT_GLYPH_PADDING 4
+
+static double get_time_s(void);
+static void scan_dir(Assets *assets, const char *dir_path);
+static int compare_assets_by_path(const void *a, const void *b);
+static void *decode_worker(void *arg);
+static bool decode_next_job(Assets *assets);
+static void decode_asset(Asset *asset, unsigned int type_mask);
+
+void scan_assets(Assets *assets, const char *dir_path) {
+    double start = get_time_s();
+
+    memset(assets, 0, sizeof(Assets));
+    scan_dir(assets, dir_path);
+    qsort(assets->assets, assets->n, sizeof(Asset), compare_assets_by_path);
+
+    assets->scan_time = get_time_s() - start;
+}
+
+void request_asset_font(Assets *assets, const char *file_path, int font_size) {
+    Asset *asset = get_asset(assets, file_path);
+    if (asset == NULL || asset->type != ASSET_FONT) {
+        TraceLog(LOG_WARNING, "ASSETS: %s is not a font", file_path);
+        return;
+    }
+    if (asset->n_fonts == MAX_N_ASSET_FONT_SIZES) {
+        TraceLog(LOG_WARNING, "ASSETS: Too many sizes of %s", file_path);
+        return;
+    }
+
+    asset->fonts[asset->n_fonts++].size = font_size;
+}
+
+void decode_assets(Assets *assets, unsigned int type_mask) {
+    start_decode_assets(assets, type_mask);
+    finish_decode_assets(assets);
+}
+
+// Queues the assets of the types and returns, the background workers decode them
+void start_decode_assets(Assets *assets, unsigned int type_mask) {
+    assets->decode_start_time = get_time_s();
+
+    // the biggest files go first, so the workers finish at about the same time
+    DecodeQueue *queue = &assets->queue;
+    queue->type_mask = type_mask;
+    queue->n_jobs = 0;
+    for (int i = 0; i < assets->n; ++i) {
+        if (type_mask & ASSET_TYPE_BIT(assets->assets[i].type)) {
+            queue->jobs[queue->n_jobs++] = i;
+        }
+    }
+    for (int i = 1; i < queue->n_jobs; ++i) {
+        int job = queue->jobs[i];
+        int j = i;
+        while (j > 0 && assets->assets[queue->jobs[j - 1]].file_size
+                            < assets->assets[job].file_size) {
+            queue->jobs[j] = queue->jobs[j - 1];
+            j -= 1;
+        }
+        queue->jobs[j] = job;
+    }
+    queue->next_job = 0;
+
+    assets->is_decoding = true;
+    assets->n_workers = 0;
+#if !defined(PLATFORM_WEB)
+    int n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1) n_threads = 1;
+    if (n_threads > MAX_N_ASSET_WORKERS) n_threads = MAX_N_ASSET_WORKERS;
+    if (n_threads > queue->n_jobs) n_threads = queue->n_jobs;
+
+    for (int i = 0; i < n_threads; ++i) {
+        pthread_t *worker = &assets->workers[assets->n_workers];
+        if (pthread_create(worker, NULL, decode_worker, assets) != 0) break;
+        assets->n_workers += 1;
+    }
+#endif
+}
+
+// No threads without SharedArrayBuffer (web) or if they failed to start: then
+// the calling thread decodes one job, and more while the time budget lasts
+void pump_decode_assets(Assets *assets, double time_budget) {
+    if (assets->n_workers > 0) return;
+
+    double start = get_time_s();
+    do {
+        if (!decode_next_job(assets)) break;
+    } while (get_time_s() - start < time_budget);
+}
+
+// Blocks until the started decoding is done: the calling thread takes the
+// remaining jobs too, then the workers are joined
+void finish_decode_assets(Assets *assets) {
+    if (!assets->is_decoding) return;
+
+    while (decode_next_job(assets)) continue;
+#if !defined(PLATFORM_WEB)
+    for (int i = 0; i < assets->n_workers; ++i) {
+        pthread_join(assets->workers[i], NULL);
+    }
+#endif
+    assets->n_threads = assets->n_workers + 1;
+    assets->n_workers = 0;
+    assets->is_decoding = false;
+    assets->decode_time = get_time_s() - assets->decode_start_time;
+}
+
+// True once every asset of the types is decoded, the types must have been queued
+bool are_assets_decoded(Assets *assets, unsigned int type_mask) {
+    for (int i = 0; i < assets->n; ++i) {
+        Asset *asset = &assets->assets[i];
+        if (!(type_mask & ASSET_TYPE_BIT(asset->type))) continue;
+#if !defined(PLATFORM_WEB)
+        if (!atomic_load_explicit(&asset->is_decoded, memory_order_acquire)) return false;
+#else
+        if (!asset->is_decoded) return false;
+#endif
+    }
+    return true;
+}
+
+void unload_assets(Assets *assets) {
+    for (int i = 0; i < assets->n; ++i) {
+        Asset *asset = &assets->assets[i];
+        UnloadImage(asset->image);
+        UnloadWave(asset->wave);
+        for (int j = 0; j < asset->n_fonts; ++j) {
+            AssetFont *font = &asset->fonts[j];
+            UnloadFontData(font->glyphs, font->n_glyphs);
+            MemFree(font->recs);
+            UnloadImage(font->atlas);
+        }
+
+        asset->is_decoded = false;
+        asset->image = (Image){0};
+        asset->wave = (Wave){0};
+        asset->n_fonts = 0;
+    }
+}
+
+AssetType get_asset_type(const char *file_path) {
+    if (IsFileExtension(file_path, ".png")) return ASSET_IMAGE;
+    if (IsFileExtension(file_path, ".wav")) return ASSET_WAVE;
+    if (IsFileExtension(file_path, ".ttf")) return ASSET_FONT;
+    return ASSET_OTHER;
+}
+
+Asset *get_asset(Assets *assets, const char *file_path) {
+    Asset key;
+    strncpy(key.file_path, file_path, MAX_ASSET_PATH_LEN - 1);
+    key.file_path[MAX_ASSET_PATH_LEN - 1] = '\0';
+
+    return bsearch(
+        &key, assets->assets, assets->n, sizeof(Asset), compare_assets_by_path
+    );
+}
+
+Texture2D load_texture_from_asset(Asset *asset) {
+    if (asset == NULL || !IsImageReady(asset->image)) return (Texture2D){0};
+    return LoadTextureFromImage(asset->image);
+}
+
+Sound load_sound_from_asset(Asset *asset) {
+    if (asset == NULL || !IsWaveReady(asset->wave)) return (Sound){0};
+    return LoadSoundFromWave(asset->wave);
+}
+
+// Same as LoadFontEx, but the glyphs and the atlas are already rasterized. The
+// font takes the ownership of the glyphs and recs, only the atlas image is kept
+Font load_font_from_asset(Asset *asset, int font_size) {
+    Font font = {0};
+    if (asset == NULL) return font;
+
+    for (int i = 0; i < asset->n_fonts; ++i) {
+        AssetFont *asset_font = &asset->fonts[i];
+        if (asset_font->size != font_size || asset_font->glyphs == NULL) continue;
+
+        font.baseSize = font_size;
+        font.glyphCount = asset_font->n_glyphs;
+        font.glyphPadding = FONT_GLYPH_PADDING;
+        font.glyphs = asset_font->glyphs;
+        font.recs = asset_font->recs;
+        font.texture = LoadTextureFromImage(asset_font->atlas);
+
+        asset_font->glyphs = NULL;
+        asset_font->recs = NULL;
+        asset_font->n_glyphs = 0;
+        break;
+    }
+
+    return font;
+}
+
+static double get_time_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void scan_dir(Assets *assets, const char *dir_path) {
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL) {
+        TraceLog(LOG_ERROR, "ASSETS: Failed to open directory %s", dir_path);
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+
+        char file_path[MAX_ASSET_PATH_LEN];
+        int len = snprintf(
+            file_path, sizeof(file_path), "%s/%s", dir_path, entry->d_name
+        );
+        if (len >= MAX_ASSET_PATH_LEN) {
+            TraceLog(LOG_WARNING, "ASSETS: Path is too long: %s", file_path);
+            continue;
+        }
+
+        struct stat st;
+        if (stat(file_path, &st) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            scan_dir(assets, file_path);
+        } else if (S_ISREG(st.st_mode)) {
+            if (assets->n == MAX_N_ASSETS) {
+                TraceLog(LOG_WARNING, "ASSETS: Too many files, %s is skipped", file_path);
+                continue;
+            }
+
+            Asset *asset = &assets->assets[assets->n++];
+            memset(asset, 0, sizeof(Asset));
+            strcpy(asset->file_path, file_path);
+            asset->file_size = st.st_size;
+            asset->type = get_asset_type(file_path);
+        }
+    }
+
+    closedir(dir);
+}
+
+static int compare_assets_by_path(const void *a, const void *b) {
+    return strcmp(((const Asset *)a)->file_path, ((const Asset *)b)->file_path);
+}
+
+static void *decode_worker(void *arg) {
+    Assets *assets = arg;
+    while (decode_next_job(assets)) continue;
+    return NULL;
+}
+
+// Returns false once the queue is empty
+static bool decode_next_job(Assets *assets) {
+    DecodeQueue *queue = &assets->queue;
+#if !defined(PLATFORM_WEB)
+    if (atomic_load(&queue->next_job) >= queue->n_jobs) return false;
+    int job = atomic_fetch_add(&queue->next_job, 1);
+#else
+    if (queue->next_job >= queue->n_jobs) return false;
+    int job = queue->next_job++;
+#endif
+    if (job >= queue->n_jobs) return false;
+
+    Asset *asset = &assets->assets[queue->jobs[job]];
+    decode_asset(asset, queue->type_mask);
+#if !defined(PLATFORM_WEB)
+    atomic_store_explicit(&asset->is_decoded, true, memory_order_release);
+#else
+    asset->is_decoded = true;
+#endif
+    return true;
+}
+
+// Runs on the worker threads, also while the main thread draws: only raylib
+// functions which don't touch the GPU, the audio device or the shared TextFormat
+// buffers can be called here
+static void decode_asset(Asset *asset, unsigned int type_mask) {
+    if (!(type_mask & ASSET_TYPE_BIT(asset->type))) return;
+
+    // packed files are decoded right from the mapped memory
+    const char *file_type = GetFileExtension(asset->file_path);
+    const unsigned char *packed_data = asset->data;
+    int packed_size = asset->file_size;
+
+    if (asset->type == ASSET_IMAGE) {
+        if (packed_data) {
+            asset->image = LoadImageFromMemory(file_type, packed_data, packed_size);
+        } else {
+            asset->image = LoadImage(asset->file_path);
+        }
+    } else if (asset->type == ASSET_WAVE) {
+        if (packed_data) {
+            asset->wave = LoadWaveFromMemory(file_type, packed_data, packed_size);
+        } else {
+            asset->wave = LoadWave(asset->file_path);
+        }
+    } else if (asset->type == ASSET_FONT && asset->n_fonts > 0) {
+        int size = packed_size;
+        unsigned char *data = (unsigned char *)packed_data;
+        if (data == NULL) data = LoadFileData(asset->file_path, &size);
+        if (data == NULL) return;
+
+        for (int i = 0; i < asset->n_fonts; ++i) {
+            AssetFont *font = &asset->fonts[i];
+            font->glyphs = LoadFontData(data, size, font->size, NULL, 0, FONT_DEFAULT);
+            if (font->glyphs == NULL) continue;
+
+            font->n_glyphs = 95;  // default ASCII set, as with LoadFontEx(.., 0, 0)
+            font->atlas = GenImageFontAtlas(
+                font->glyphs,
+                &font->recs,
+                font->n_glyphs,
+                font->size,
+                FONT_GLYPH_PADDING,
+                0
+            );
+
+            // a solid white block in the free bottom-right corner, like raylib's
+            // SUPPORT_FONT_ATLAS_WHITE_REC, for push_rect to queue with the text
+            ImageDrawRectangle(
+                &font->atlas, font->atlas.width - 3, font->atlas.height - 3, 3, 3, WHITE
+            );
+
+            // glyph images point into the atlas, like in LoadFontEx
+            for (int j = 0; j < font->n_glyphs; ++j) {
+                UnloadImage(font->glyphs[j].image);
+                font->glyphs[j].image = ImageFromImage(font->atlas, font->recs[j]);
+            }
+        }
+
+        if (data != packed_data) UnloadFileData(data);
+    }
+}
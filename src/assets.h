@@ -0,0 +1,98 @@
+#pragma once
+
+#include "raylib.h"
+#include <stdbool.h>
+
+#if !defined(PLATFORM_WEB)
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+#define MAX_N_ASSETS 128
+#define MAX_ASSET_PATH_LEN 128
+#define MAX_N_ASSET_FONT_SIZES 4
+#define MAX_N_ASSET_WORKERS 8
+
+#define ASSET_TYPE_BIT(type) (1u << (type))
+
+typedef enum AssetType {
+    ASSET_OTHER = 0,  // opened by the main thread itself (models, music, shaders)
+    ASSET_IMAGE,
+    ASSET_WAVE,
+    ASSET_FONT,
+} AssetType;
+
+// Font rasterized at one size: glyphs and the atlas image, without the texture
+typedef struct AssetFont {
+    int size;
+    int n_glyphs;
+    GlyphInfo *glyphs;
+    Rectangle *recs;
+    Image atlas;
+} AssetFont;
+
+typedef struct Asset {
+    AssetType type;
+    char file_path[MAX_ASSET_PATH_LEN];
+    int file_size;
+    const unsigned char *data;  // file contents in the mapped pack, NULL if loose
+
+    // CPU side data, filled by decode_assets
+#if !defined(PLATFORM_WEB)
+    atomic_bool is_decoded;
+#else
+    bool is_decoded;
+#endif
+    Image image;
+    Wave wave;
+    int n_fonts;
+    AssetFont fonts[MAX_N_ASSET_FONT_SIZES];
+} Asset;
+
+typedef struct DecodeQueue {
+    unsigned int type_mask;
+    int n_jobs;
+    int jobs[MAX_N_ASSETS];
+#if !defined(PLATFORM_WEB)
+    atomic_int next_job;
+#else
+    int next_job;
+#endif
+} DecodeQueue;
+
+// Manifest of the resources directory built by a single scan and sorted by the
+// file path. Decoding (PNG, WAV, TTF rasterization) is spread over a pool of
+// worker threads, only GPU and audio device uploads are left to the caller.
+// decode_assets blocks, start_decode_assets returns at once and the caller
+// uploads each type as soon as are_assets_decoded says so
+typedef struct Assets {
+    int n;
+    Asset assets[MAX_N_ASSETS];
+
+    DecodeQueue queue;
+#if !defined(PLATFORM_WEB)
+    pthread_t workers[MAX_N_ASSET_WORKERS];
+#endif
+    bool is_decoding;  // started and not finished yet
+    int n_workers;     // running in the background
+    double decode_start_time;
+
+    int n_threads;
+    double scan_time;
+    double decode_time;
+} Assets;
+
+void scan_assets(Assets *assets, const char *dir_path);
+void request_asset_font(Assets *assets, const char *file_path, int font_size);
+void decode_assets(Assets *assets, unsigned int type_mask);
+void start_decode_assets(Assets *assets, unsigned int type_mask);
+void pump_decode_assets(Assets *assets, double time_budget);
+void finish_decode_assets(Assets *assets);
+bool are_assets_decoded(Assets *assets, unsigned int type_mask);
+void unload_assets(Assets *assets);
+AssetType get_asset_type(const char *file_path);
+Asset *get_asset(Assets *assets, const char *file_path);
+
+Texture2D load_texture_from_asset(Asset *asset);
+Sound load_sound_from_asset(Asset *asset);
+Font load_font_from_asset(Asset *asset, int font_size);
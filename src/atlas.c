@@ -0,0 +1,83 @@
+#include "atlas.h"
+
+#include <string.h>
+
+// Shelf packing: images are placed in rows from the tallest to the shortest,
+// sprite strips have the same height, so they fill the rows tightly
+void pack_atlas(Atlas *atlas, const char **names, const Image *images, int n_images) {
+    memset(atlas, 0, sizeof(Atlas));
+    if (n_images > MAX_N_ATLAS_REGIONS) {
+        TraceLog(
+            LOG_WARNING, "ATLAS: Too many images, only %d are packed", MAX_N_ATLAS_REGIONS
+        );
+        n_images = MAX_N_ATLAS_REGIONS;
+    }
+
+    int order[MAX_N_ATLAS_REGIONS];
+    for (int i = 0; i < n_images; ++i) {
+        int j = i;
+        while (j > 0 && images[order[j - 1]].height < images[i].height) {
+            order[j] = order[j - 1];
+            j -= 1;
+        }
+        order[j] = i;
+    }
+
+    int x = 0;
+    int y = 0;
+    int shelf_height = 0;
+    for (int k = 0; k < n_images; ++k) {
+        int i = order[k];
+        int width = images[i].width + ATLAS_PADDING;
+        int height = images[i].height + ATLAS_PADDING;
+        if (x + width > ATLAS_WIDTH) {
+            x = 0;
+            y += shelf_height;
+            shelf_height = 0;
+        }
+
+        strncpy(atlas->names[i], names[i], MAX_ATLAS_NAME_LEN - 1);
+        atlas->regions[i] = (Rectangle){x, y, images[i].width, images[i].height};
+        x += width;
+        if (height > shelf_height) shelf_height = height;
+    }
+    atlas->n_regions = n_images;
+
+    atlas->width = ATLAS_WIDTH;
+    atlas->height = 1;
+    while (atlas->height < y + shelf_height) atlas->height *= 2;
+}
+
+// Composes the packed images into one image and uploads it (needs a window)
+void load_atlas_texture(Atlas *atlas, const Image *images) {
+    Image image = GenImageColor(atlas->width, atlas->height, BLANK);
+    unsigned char *dst = image.data;
+
+    for (int i = 0; i < atlas->n_regions; ++i) {
+        if (images[i].data == NULL) continue;
+
+        Image src = ImageCopy(images[i]);
+        ImageFormat(&src, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+        Rectangle region = atlas->regions[i];
+        int row_size = src.width * 4;
+        for (int row = 0; row < src.height; ++row) {
+            int offset = (((int)region.y + row) * atlas->width + (int)region.x) * 4;
+            memcpy(dst + offset, (unsigned char *)src.data + row * row_size, row_size);
+        }
+        UnloadImage(src);
+    }
+
+    atlas->texture = LoadTextureFromImage(image);
+    SetTextureFilter(atlas->texture, TEXTURE_FILTER_BILINEAR);
+    UnloadImage(image);
+}
+
+Rectangle get_atlas_region(const Atlas *atlas, const char *name) {
+    for (int i = 0; i < atlas->n_regions; ++i) {
+        if (strcmp(atlas->names[i], name) == 0) return atlas->regions[i];
+    }
+
+    TraceLog(LOG_WARNING, "ATLAS: Region %s is missing", name);
+    return (Rectangle){0};
+}
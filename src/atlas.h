@@ -0,0 +1,24 @@
+#pragma once
+
+#include "raylib.h"
+
+#define MAX_N_ATLAS_REGIONS 32
+#define MAX_ATLAS_NAME_LEN 32
+#define ATLAS_WIDTH 1024
+#define ATLAS_PADDING 2  // transparent gap, so filtering doesn't bleed between regions
+
+// Sprite strips and icons packed into one texture, so drawing any of them
+// doesn't switch textures. Regions are looked up by the image name at load time
+typedef struct Atlas {
+    int width;
+    int height;
+    int n_regions;
+    char names[MAX_N_ATLAS_REGIONS][MAX_ATLAS_NAME_LEN];
+    Rectangle regions[MAX_N_ATLAS_REGIONS];
+
+    Texture2D texture;
+} Atlas;
+
+void pack_atlas(Atlas *atlas, const char **names, const Image *images, int n_images);
+void load_atlas_texture(Atlas *atlas, const Image *images);
+Rectangle get_atlas_region(const Atlas *atlas, const char *name);
@@ -0,0 +1,160 @@
+#include "audio.h"
+
+#include <string.h>
+#include <time.h>
+
+#define LISTENER_DIRTY 4
+
+static void update_audio_worker(AudioWorker *worker);
+static void run_audio_command(AudioWorker *worker, AudioCommand command);
+#if !defined(PLATFORM_WEB)
+static void *audio_worker_thread(void *arg);
+#endif
+
+void init_audio_worker(AudioWorker *worker) {
+    memset(worker, 0, sizeof(AudioWorker));
+    worker->listener_back = 0;
+    worker->listener_middle = 1;
+    worker->listener_front = 2;
+}
+
+// Musics are registered before the worker starts, it owns them from then on
+int add_audio_music(AudioWorker *worker, Music music) {
+    if (worker->n_musics == MAX_N_AUDIO_MUSICS) {
+        TraceLog(LOG_WARNING, "AUDIO: Too many musics, max %d", MAX_N_AUDIO_MUSICS);
+        return -1;
+    }
+    worker->musics[worker->n_musics] = music;
+    return worker->n_musics++;
+}
+
+void start_audio_worker(AudioWorker *worker) {
+#if !defined(PLATFORM_WEB)
+    worker->should_stop = false;
+    int result = pthread_create(&worker->thread, NULL, audio_worker_thread, worker);
+    worker->is_started = result == 0;
+    if (!worker->is_started) {
+        TraceLog(LOG_WARNING, "AUDIO: Failed to start the worker, pumping inline");
+    }
+#endif
+}
+
+void stop_audio_worker(AudioWorker *worker) {
+#if !defined(PLATFORM_WEB)
+    if (!worker->is_started) return;
+    atomic_store(&worker->should_stop, true);
+    pthread_join(worker->thread, NULL);
+    worker->is_started = false;
+#endif
+}
+
+// Called once per frame: a no-op if the worker runs on its own thread
+void pump_audio_worker(AudioWorker *worker) {
+#if !defined(PLATFORM_WEB)
+    if (worker->is_started) return;
+#endif
+    update_audio_worker(worker);
+}
+
+// Returns false if the queue is full, the command is dropped then
+bool push_audio_command(AudioWorker *worker, AudioCommand command) {
+#if !defined(PLATFORM_WEB)
+    unsigned int head = atomic_load_explicit(&worker->queue_head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&worker->queue_tail, memory_order_acquire);
+#else
+    unsigned int head = worker->queue_head;
+    unsigned int tail = worker->queue_tail;
+#endif
+    if (head - tail == AUDIO_QUEUE_SIZE) return false;
+
+    worker->queue[head & (AUDIO_QUEUE_SIZE - 1)] = command;
+#if !defined(PLATFORM_WEB)
+    atomic_store_explicit(&worker->queue_head, head + 1, memory_order_release);
+#else
+    worker->queue_head = head + 1;
+#endif
+    return true;
+}
+
+// The game fills the returned listener and publishes it, the mixer always
+// reads the latest published one
+AudioListener *get_audio_listener(AudioWorker *worker) {
+    return &worker->listeners[worker->listener_back];
+}
+
+void publish_audio_listener(AudioWorker *worker) {
+#if !defined(PLATFORM_WEB)
+    int prev = atomic_exchange_explicit(
+        &worker->listener_middle,
+        worker->listener_back | LISTENER_DIRTY,
+        memory_order_acq_rel
+    );
+#else
+    int prev = worker->listener_middle;
+    worker->listener_middle = worker->listener_back | LISTENER_DIRTY;
+#endif
+    worker->listener_back = prev & ~LISTENER_DIRTY;
+}
+
+// Returns the listener published since the last call, NULL if there is none
+const AudioListener *read_audio_listener(AudioWorker *worker) {
+#if !defined(PLATFORM_WEB)
+    if (!(atomic_load_explicit(&worker->listener_middle, memory_order_acquire)
+          & LISTENER_DIRTY)) {
+        return NULL;
+    }
+    int middle = atomic_exchange_explicit(
+        &worker->listener_middle, worker->listener_front, memory_order_acq_rel
+    );
+#else
+    if (!(worker->listener_middle & LISTENER_DIRTY)) return NULL;
+    int middle = worker->listener_middle;
+    worker->listener_middle = worker->listener_front;
+#endif
+    worker->listener_front = middle & ~LISTENER_DIRTY;
+    return &worker->listeners[worker->listener_front];
+}
+
+static void update_audio_worker(AudioWorker *worker) {
+    // commands
+#if !defined(PLATFORM_WEB)
+    unsigned int tail = atomic_load_explicit(&worker->queue_tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&worker->queue_head, memory_order_acquire);
+#else
+    unsigned int tail = worker->queue_tail;
+    unsigned int head = worker->queue_head;
+#endif
+    for (; tail != head; ++tail) {
+        run_audio_command(worker, worker->queue[tail & (AUDIO_QUEUE_SIZE - 1)]);
+    }
+#if !defined(PLATFORM_WEB)
+    atomic_store_explicit(&worker->queue_tail, tail, memory_order_release);
+#else
+    worker->queue_tail = tail;
+#endif
+
+    for (int i = 0; i < worker->n_musics; ++i) {
+        UpdateMusicStream(worker->musics[i]);
+    }
+}
+
+static void run_audio_command(AudioWorker *worker, AudioCommand command) {
+    if (command.music < 0 || command.music >= worker->n_musics) return;
+    Music music = worker->musics[command.music];
+
+    switch (command.type) {
+        case AUDIO_PLAY_MUSIC: PlayMusicStream(music); break;
+    }
+}
+
+#if !defined(PLATFORM_WEB)
+static void *audio_worker_thread(void *arg) {
+    AudioWorker *worker = arg;
+    struct timespec period = {0, (long)(AUDIO_WORKER_PERIOD * 1e9)};
+    while (!atomic_load(&worker->should_stop)) {
+        update_audio_worker(worker);
+        nanosleep(&period, NULL);
+    }
+    return NULL;
+}
+#endif
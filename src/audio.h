@@ -0,0 +1,70 @@
+#pragma once
+
+#include "raylib.h"
+#include <stdbool.h>
+
+#if !defined(PLATFORM_WEB)
+#include <pthread.h>
+#include <stdatomic.h>
+#endif
+
+#define MAX_N_AUDIO_MUSICS 4
+#define AUDIO_QUEUE_SIZE 64         // commands, a power of two
+#define MAX_N_AUDIO_SOURCES 1024    // positions per listener snapshot
+#define AUDIO_WORKER_PERIOD 0.005  // s between stream refills
+
+typedef enum AudioCommandType {
+    AUDIO_PLAY_MUSIC,
+} AudioCommandType;
+
+typedef struct AudioCommand {
+    AudioCommandType type;
+    int music;
+} AudioCommand;
+
+// What the spatial mixer hears: the player and the positions of the sound
+// sources (running enemies) of one tick
+typedef struct AudioListener {
+    Vector3 position;
+    int n_sources;
+    Vector3 sources[MAX_N_AUDIO_SOURCES];
+} AudioListener;
+
+// Owns the music streams: refills (and decodes) them on its own thread, so a
+// long frame doesn't starve the streams. The game talks to it through a single
+// producer, single consumer command queue, and hands the listener to the mixer
+// (one reader) through a triple buffer, neither side blocks. Without threads
+// (web) pump_audio_worker does the same work on the main thread
+typedef struct AudioWorker {
+    int n_musics;
+    Music musics[MAX_N_AUDIO_MUSICS];
+
+#if !defined(PLATFORM_WEB)
+    pthread_t thread;
+    bool is_started;
+    atomic_bool should_stop;
+    atomic_uint queue_head;  // written by the game
+    atomic_uint queue_tail;  // written by the worker
+    atomic_int listener_middle;  // slot index, LISTENER_DIRTY if unread
+#else
+    unsigned int queue_head;
+    unsigned int queue_tail;
+    int listener_middle;
+#endif
+    AudioCommand queue[AUDIO_QUEUE_SIZE];
+
+    int listener_back;   // slot the game fills
+    int listener_front;  // slot the mixer reads
+    AudioListener listeners[3];
+} AudioWorker;
+
+void init_audio_worker(AudioWorker *worker);
+int add_audio_music(AudioWorker *worker, Music music);
+void start_audio_worker(AudioWorker *worker);
+void stop_audio_worker(AudioWorker *worker);
+void pump_audio_worker(AudioWorker *worker);
+
+bool push_audio_command(AudioWorker *worker, AudioCommand command);
+AudioListener *get_audio_listener(AudioWorker *worker);
+void publish_audio_listener(AudioWorker *worker);
+const AudioListener *read_audio_listener(AudioWorker *worker);
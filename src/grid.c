@@ -0,0 +1,91 @@
+#include "grid.h"
+
+#include <math.h>
+
+static int get_position_bucket(Grid *grid, Vector2 position);
+
+void grid_init(Grid *grid, float cell_size) {
+    grid->inv_cell_size = 1.0 / cell_size;
+    for (int i = 0; i < GRID_SIZE * GRID_SIZE; ++i) {
+        grid->bucket_head[i] = -1;
+    }
+}
+
+void grid_insert(Grid *grid, int item, Vector2 position) {
+    int bucket = get_position_bucket(grid, position);
+    int head = grid->bucket_head[bucket];
+
+    grid->item_bucket[item] = bucket;
+    grid->item_prev[item] = -1;
+    grid->item_next[item] = head;
+    if (head != -1) grid->item_prev[head] = item;
+    grid->bucket_head[bucket] = item;
+}
+
+void grid_remove(Grid *grid, int item) {
+    int prev = grid->item_prev[item];
+    int next = grid->item_next[item];
+
+    if (prev != -1) grid->item_next[prev] = next;
+    else grid->bucket_head[grid->item_bucket[item]] = next;
+    if (next != -1) grid->item_prev[next] = prev;
+}
+
+void grid_move(Grid *grid, int item, Vector2 position) {
+    if (get_position_bucket(grid, position) == grid->item_bucket[item]) return;
+    grid_remove(grid, item);
+    grid_insert(grid, item, position);
+}
+
+void grid_rename(Grid *grid, int item, int new_item) {
+    int bucket = grid->item_bucket[item];
+    int prev = grid->item_prev[item];
+    int next = grid->item_next[item];
+
+    grid->item_bucket[new_item] = bucket;
+    grid->item_prev[new_item] = prev;
+    grid->item_next[new_item] = next;
+    if (prev != -1) grid->item_next[prev] = new_item;
+    else grid->bucket_head[bucket] = new_item;
+    if (next != -1) grid->item_prev[next] = new_item;
+}
+
+GridQuery grid_query(Grid *grid, Vector2 center, float radius) {
+    GridQuery query = {.grid = grid, .item = -1};
+
+    query.min_x = floorf((center.x - radius) * grid->inv_cell_size);
+    query.max_x = floorf((center.x + radius) * grid->inv_cell_size);
+    query.max_y = floorf((center.y + radius) * grid->inv_cell_size);
+    query.x = query.min_x - 1;
+    query.y = floorf((center.y - radius) * grid->inv_cell_size);
+
+    // wider windows would visit the same buckets twice
+    if (query.max_x - query.min_x >= GRID_SIZE) query.max_x = query.min_x + GRID_SIZE - 1;
+    if (query.max_y - query.y >= GRID_SIZE) query.max_y = query.y + GRID_SIZE - 1;
+
+    return query;
+}
+
+bool grid_query_next(GridQuery *query, int *item) {
+    while (query->item == -1) {
+        if (++query->x > query->max_x) {
+            query->x = query->min_x;
+            if (++query->y > query->max_y) return false;
+        }
+        query->item = query->grid->bucket_head[grid_get_bucket(query->x, query->y)];
+    }
+
+    *item = query->item;
+    query->item = query->grid->item_next[query->item];
+    return true;
+}
+
+int grid_get_bucket(int x, int y) {
+    return (x & (GRID_SIZE - 1)) + (y & (GRID_SIZE - 1)) * GRID_SIZE;
+}
+
+static int get_position_bucket(Grid *grid, Vector2 position) {
+    int x = floorf(position.x * grid->inv_cell_size);
+    int y = floorf(position.y * grid->inv_cell_size);
+    return grid_get_bucket(x, y);
+}
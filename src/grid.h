@@ -0,0 +1,38 @@
+#pragma once
+
+#include "raylib.h"
+
+#define GRID_SIZE 64  // cells per axis, power of two
+#define GRID_MAX_N_ITEMS 16384
+
+// Uniform grid over the xy plane which wraps around every GRID_SIZE cells, so
+// any query window up to GRID_SIZE cells wide visits each bucket once. Items far
+// apart may share a bucket, queries return candidates and the caller checks the
+// actual distance. Items are kept in per-bucket linked lists: moving an item only
+// relinks it when it crosses a cell border
+typedef struct Grid {
+    float inv_cell_size;
+    int bucket_head[GRID_SIZE * GRID_SIZE];
+    int item_bucket[GRID_MAX_N_ITEMS];
+    int item_next[GRID_MAX_N_ITEMS];
+    int item_prev[GRID_MAX_N_ITEMS];
+} Grid;
+
+typedef struct GridQuery {
+    Grid *grid;
+    int min_x;
+    int max_x;
+    int max_y;
+    int x;
+    int y;
+    int item;
+} GridQuery;
+
+void grid_init(Grid *grid, float cell_size);
+void grid_insert(Grid *grid, int item, Vector2 position);
+void grid_remove(Grid *grid, int item);
+void grid_move(Grid *grid, int item, Vector2 position);
+void grid_rename(Grid *grid, int item, int new_item);  // new_item must not be in the grid
+GridQuery grid_query(Grid *grid, Vector2 center, float radius);
+bool grid_query_next(GridQuery *query, int *item);
+int grid_get_bucket(int x, int y);  // of the cell, wrapped around
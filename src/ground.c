@@ -0,0 +1,64 @@
+#include "ground.h"
+
+#include "rlgl.h"
+
+void load_ground(Ground *ground, Shaders *shaders) {
+    ground->bake_shader = load_shader(shaders, 0, "ground_bake.frag");
+    ground->bake_radius = get_uniform_float(ground->bake_shader, "u_radius");
+    ground->bake_size = get_uniform_float(ground->bake_shader, "u_size");
+
+    ground->shader = load_shader(shaders, 0, "ground.frag");
+    ground->light_pos = get_uniform_vec2(ground->shader, "u_light_pos");
+    ground->radius = get_uniform_float(ground->shader, "u_radius");
+
+    ground->texture = LoadRenderTexture(GROUND_TEXTURE_SIZE, GROUND_TEXTURE_SIZE);
+    SetTextureFilter(ground->texture.texture, TEXTURE_FILTER_BILINEAR);
+    ground->baked_radius = 0.0;
+}
+
+// Re-bakes the material when the radius changes. Switches the render target,
+// so it's called outside of the 3d mode
+void update_ground(Ground *ground, float radius) {
+    if (radius == ground->baked_radius) return;
+
+    set_uniform_float(ground->bake_radius, radius);
+    set_uniform_float(ground->bake_size, GROUND_TEXTURE_SIZE);
+
+    // the alpha channel holds the height, so it's written as is, not blended
+    BeginTextureMode(ground->texture);
+    ClearBackground(BLANK);
+    rlSetBlendFactors(RL_ONE, RL_ZERO, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM);
+    BeginShaderMode(ground->bake_shader);
+    DrawRectangle(0, 0, GROUND_TEXTURE_SIZE, GROUND_TEXTURE_SIZE, WHITE);
+    EndShaderMode();
+    EndBlendMode();
+    EndTextureMode();
+
+    set_uniform_float(ground->radius, radius);
+    ground->baked_radius = radius;
+}
+
+// One textured quad under the arena, the shader discards the corners
+void draw_ground(Ground *ground, Vector2 light_pos) {
+    float r = ground->baked_radius;
+    float z = -0.1;
+    set_uniform_vec2(ground->light_pos, light_pos);
+
+    BeginShaderMode(ground->shader);
+    rlSetTexture(ground->texture.texture.id);
+    rlBegin(RL_QUADS);
+    rlColor4ub(255, 255, 255, 255);
+    rlNormal3f(0.0, 0.0, 1.0);
+    rlTexCoord2f(0.0, 0.0);
+    rlVertex3f(-r, -r, z);
+    rlTexCoord2f(1.0, 0.0);
+    rlVertex3f(r, -r, z);
+    rlTexCoord2f(1.0, 1.0);
+    rlVertex3f(r, r, z);
+    rlTexCoord2f(0.0, 1.0);
+    rlVertex3f(-r, r, z);
+    rlEnd();
+    rlSetTexture(0);
+    EndShaderMode();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "raylib.h"
+#include "shader.h"
+
+#define GROUND_TEXTURE_SIZE 1024
+
+// The brick arena floor. Its material doesn't change over time, so it's
+// baked into a texture (brick mask, normal and height) once per radius, and
+// only the lighting is computed per frame
+typedef struct Ground {
+    Shader bake_shader;
+    UniformFloat bake_radius;
+    UniformFloat bake_size;
+
+    Shader shader;
+    UniformVec2 light_pos;
+    UniformFloat radius;
+
+    RenderTexture2D texture;
+    float baked_radius;  // 0 until the first bake
+} Ground;
+
+void load_ground(Ground *ground, Shaders *shaders);
+void update_ground(Ground *ground, float radius);
+void draw_ground(Ground *ground, Vector2 light_pos);
@@ -0,0 +1,233 @@
+#include "matcher.h"
+
+#include <string.h>
+
+static int find_child(Matcher *matcher, int node, char ch);
+static int alloc_node(Matcher *matcher, int parent, char ch);
+static void free_node(Matcher *matcher, int node);
+static void add_subtree_n_matched(Matcher *matcher, int node, int delta);
+
+void matcher_init(Matcher *matcher) {
+    matcher->n_nodes = 1;
+    matcher->n_free_nodes = 0;
+    matcher->free_node = -1;
+    matcher->nodes[0] = (MatcherNode){
+        .parent = -1, .first_child = -1, .next_sibling = -1, .first_target = -1};
+
+    for (int i = 0; i < MATCHER_MAX_N_TARGETS; ++i) {
+        matcher->target_node[i] = -1;
+    }
+
+    matcher->prompt_len = 0;
+    matcher->n_matched = 0;
+    matcher->path[0] = 0;
+    matcher->submit_node = -1;
+    matcher->is_changed = true;
+}
+
+bool matcher_insert(Matcher *matcher, int target, const char *name) {
+    int len = strnlen(name, MATCHER_MAX_PROMPT_LEN - 1);
+
+    // make sure the whole path can be allocated before touching the trie
+    int node = 0;
+    int depth = 0;
+    while (depth < len) {
+        int child = find_child(matcher, node, name[depth]);
+        if (child == -1) break;
+        node = child;
+        depth += 1;
+    }
+    int n_free = MATCHER_MAX_N_NODES - matcher->n_nodes + matcher->n_free_nodes;
+    if (len - depth > n_free) return false;
+
+    node = 0;
+    for (int i = 0; i < len; ++i) {
+        int child = find_child(matcher, node, name[i]);
+        if (child == -1) child = alloc_node(matcher, node, name[i]);
+        node = child;
+        matcher->nodes[node].n_targets += 1;
+    }
+
+    int head = matcher->nodes[node].first_target;
+    matcher->target_node[target] = node;
+    matcher->target_prev[target] = -1;
+    matcher->target_next[target] = head;
+    if (head != -1) matcher->target_prev[head] = target;
+    matcher->nodes[node].first_target = target;
+
+    // new nodes may continue the prompt which had no path before
+    while (matcher->n_matched < matcher->prompt_len) {
+        int parent = matcher->path[matcher->n_matched];
+        int child = find_child(matcher, parent, matcher->prompt[matcher->n_matched]);
+        if (child == -1) break;
+        matcher->path[++matcher->n_matched] = child;
+    }
+
+    // the deepest node of the name which lies on the prompt path
+    while (node != 0) {
+        int node_depth = matcher->nodes[node].depth;
+        if (node_depth <= matcher->n_matched && matcher->path[node_depth] == node) break;
+        node = matcher->nodes[node].parent;
+    }
+    matcher->target_n_matched[target] = matcher->nodes[node].depth;
+    matcher->is_changed = true;
+
+    return true;
+}
+
+void matcher_remove(Matcher *matcher, int target) {
+    int node = matcher->target_node[target];
+    if (node == -1) return;
+
+    int prev = matcher->target_prev[target];
+    int next = matcher->target_next[target];
+    if (prev != -1) matcher->target_next[prev] = next;
+    else matcher->nodes[node].first_target = next;
+    if (next != -1) matcher->target_prev[next] = prev;
+    matcher->target_node[target] = -1;
+
+    while (node != 0) {
+        int parent = matcher->nodes[node].parent;
+        if (--matcher->nodes[node].n_targets == 0) free_node(matcher, node);
+        node = parent;
+    }
+    matcher->is_changed = true;
+}
+
+bool matcher_rename(Matcher *matcher, int target, const char *name) {
+    matcher_remove(matcher, target);
+    return matcher_insert(matcher, target, name);
+}
+
+void matcher_move(Matcher *matcher, int from_target, int to_target) {
+    int node = matcher->target_node[from_target];
+    if (node == -1) return;
+
+    int prev = matcher->target_prev[from_target];
+    int next = matcher->target_next[from_target];
+    if (prev != -1) matcher->target_next[prev] = to_target;
+    else matcher->nodes[node].first_target = to_target;
+    if (next != -1) matcher->target_prev[next] = to_target;
+
+    matcher->target_node[to_target] = node;
+    matcher->target_prev[to_target] = prev;
+    matcher->target_next[to_target] = next;
+    matcher->target_n_matched[to_target] = matcher->target_n_matched[from_target];
+    matcher->target_node[from_target] = -1;
+    matcher->is_changed = true;
+}
+
+void matcher_push_char(Matcher *matcher, char ch) {
+    if (matcher->prompt_len == MATCHER_MAX_PROMPT_LEN - 1) return;
+
+    bool is_path = matcher->n_matched == matcher->prompt_len;
+    matcher->prompt[matcher->prompt_len++] = ch;
+    if (!is_path) return;
+
+    int child = find_child(matcher, matcher->path[matcher->n_matched], ch);
+    if (child == -1) return;
+
+    matcher->path[++matcher->n_matched] = child;
+    add_subtree_n_matched(matcher, child, 1);
+}
+
+void matcher_pop_char(Matcher *matcher) {
+    if (matcher->prompt_len == 0) return;
+
+    if (matcher->n_matched == matcher->prompt_len) {
+        add_subtree_n_matched(matcher, matcher->path[matcher->n_matched], -1);
+        matcher->n_matched -= 1;
+    }
+    matcher->prompt_len -= 1;
+}
+
+void matcher_submit(Matcher *matcher) {
+    bool is_full_match = matcher->prompt_len > 0
+                         && matcher->n_matched == matcher->prompt_len;
+    matcher->submit_node = is_full_match ? matcher->path[matcher->n_matched] : -1;
+
+    while (matcher->prompt_len > 0) {
+        matcher_pop_char(matcher);
+    }
+}
+
+bool matcher_is_submitted(Matcher *matcher, int target) {
+    return matcher->submit_node != -1
+           && matcher->target_node[target] == matcher->submit_node;
+}
+
+int matcher_get_n_matched(Matcher *matcher, int target) {
+    if (matcher->target_node[target] == -1) return 0;
+    return matcher->target_n_matched[target];
+}
+
+static int find_child(Matcher *matcher, int node, char ch) {
+    int child = matcher->nodes[node].first_child;
+    while (child != -1 && matcher->nodes[child].ch != ch) {
+        child = matcher->nodes[child].next_sibling;
+    }
+    return child;
+}
+
+static int alloc_node(Matcher *matcher, int parent, char ch) {
+    int node;
+    if (matcher->free_node != -1) {
+        node = matcher->free_node;
+        matcher->free_node = matcher->nodes[node].next_sibling;
+        matcher->n_free_nodes -= 1;
+    } else {
+        node = matcher->n_nodes++;
+    }
+
+    MatcherNode *p = &matcher->nodes[parent];
+    matcher->nodes[node] = (MatcherNode){
+        .parent = parent,
+        .first_child = -1,
+        .next_sibling = p->first_child,
+        .first_target = -1,
+        .ch = ch,
+        .depth = p->depth + 1,
+    };
+    p->first_child = node;
+
+    return node;
+}
+
+static void free_node(Matcher *matcher, int node) {
+    MatcherNode *n = &matcher->nodes[node];
+
+    int *link = &matcher->nodes[n->parent].first_child;
+    while (*link != node) link = &matcher->nodes[*link].next_sibling;
+    *link = n->next_sibling;
+
+    // the prompt path can't go through a freed node
+    if (n->depth <= matcher->n_matched && matcher->path[n->depth] == node) {
+        matcher->n_matched = n->depth - 1;
+    }
+    if (matcher->submit_node == node) matcher->submit_node = -1;
+
+    n->next_sibling = matcher->free_node;
+    matcher->free_node = node;
+    matcher->n_free_nodes += 1;
+}
+
+static void add_subtree_n_matched(Matcher *matcher, int root, int delta) {
+    int node = root;
+    while (true) {
+        MatcherNode *n = &matcher->nodes[node];
+        for (int t = n->first_target; t != -1; t = matcher->target_next[t]) {
+            matcher->target_n_matched[t] += delta;
+            matcher->is_changed = true;
+        }
+
+        if (n->first_child != -1) {
+            node = n->first_child;
+            continue;
+        }
+        while (node != root && matcher->nodes[node].next_sibling == -1) {
+            node = matcher->nodes[node].parent;
+        }
+        if (node == root) break;
+        node = matcher->nodes[node].next_sibling;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+
+#define MATCHER_MAX_N_NODES (1 << 17)
+#define MATCHER_MAX_N_TARGETS 16384
+#define MATCHER_MAX_PROMPT_LEN 32
+
+// Prefix automaton (trie) over the names of the live targets. The prompt is a
+// path from the root: a typed char advances one state, a backspace steps back.
+// The number of prompt chars matched by every target is kept up to date by
+// visiting only the subtree which gained or lost the char, so the cost of a
+// keystroke doesn't depend on the number of unrelated targets
+typedef struct MatcherNode {
+    int parent;
+    int first_child;
+    int next_sibling;
+    int first_target;
+    int n_targets;  // in the whole subtree, the node is freed when it drops to zero
+    char ch;
+    unsigned char depth;
+} MatcherNode;
+
+typedef struct Matcher {
+    int n_nodes;
+    int n_free_nodes;
+    int free_node;
+    MatcherNode nodes[MATCHER_MAX_N_NODES];
+
+    int target_node[MATCHER_MAX_N_TARGETS];  // -1 if the target isn't inserted
+    int target_next[MATCHER_MAX_N_TARGETS];
+    int target_prev[MATCHER_MAX_N_TARGETS];
+    unsigned char target_n_matched[MATCHER_MAX_N_TARGETS];
+
+    int prompt_len;
+    int n_matched;  // prompt chars which form a path in the trie
+    char prompt[MATCHER_MAX_PROMPT_LEN];
+    int path[MATCHER_MAX_PROMPT_LEN + 1];
+
+    int submit_node;  // node of the last submitted prompt or -1
+    bool is_changed;  // set when a target is inserted, removed, moved or matches more
+                      // or fewer chars
+} Matcher;
+
+void matcher_init(Matcher *matcher);
+bool matcher_insert(Matcher *matcher, int target, const char *name);
+void matcher_remove(Matcher *matcher, int target);
+bool matcher_rename(Matcher *matcher, int target, const char *name);
+void matcher_move(Matcher *matcher, int from_target, int to_target);
+void matcher_push_char(Matcher *matcher, char ch);
+void matcher_pop_char(Matcher *matcher);
+void matcher_submit(Matcher *matcher);
+bool matcher_is_submitted(Matcher *matcher, int target);
+int matcher_get_n_matched(Matcher *matcher, int target);
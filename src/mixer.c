@@ -0,0 +1,205 @@
+#include "mixer.h"
+
+#include "raymath.h"
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+// raylib hands the processors frames in its mixing format: stereo floats
+#define MIXER_N_CHANNELS 2
+
+// the processor callback has no user data, only one mixer is attached at a time
+static SpatialMixer *MIXER;
+
+static void process_spatial_mixer(void *buffer, unsigned int n_frames);
+static void update_mixer_voices(SpatialMixer *mixer, const AudioListener *listener);
+static int get_min_voice_bucket(SpatialMixer *mixer);
+static int get_gain_bucket(SpatialMixer *mixer, float gain);
+static void add_mixer_voice(SpatialMixer *mixer, float gain, float pan, int delay);
+static void mix_chunk(SpatialMixer *mixer, float *frames, int n_frames);
+static void mix_voice(
+    float *out_l, float *out_r, const float *src, float gain_l, float gain_r, int n
+);
+
+void attach_spatial_mixer(
+    SpatialMixer *mixer, AudioWorker *worker, Music music, float max_distance, float gain
+) {
+    memset(mixer, 0, sizeof(SpatialMixer));
+    mixer->worker = worker;
+    mixer->music = music;
+    mixer->max_distance = max_distance;
+    mixer->gain = gain;
+
+    MIXER = mixer;
+    AttachAudioStreamProcessor(music.stream, process_spatial_mixer);
+}
+
+void detach_spatial_mixer(SpatialMixer *mixer) {
+    if (MIXER != mixer) return;
+    DetachAudioStreamProcessor(mixer->music.stream, process_spatial_mixer);
+    MIXER = NULL;
+}
+
+// 0 is left, 1 is right. The camera looks down the z axis with y up, so the
+// screen x is the world x
+float get_audio_pan(Vector3 listener, Vector3 source) {
+    float dx = source.x - listener.x;
+    float dy = source.y - listener.y;
+    float d = sqrtf(dx * dx + dy * dy);
+    return MIXER_PAN_CENTER + 0.5 * dx / fmaxf(d, MIXER_PAN_RADIUS);
+}
+
+static void process_spatial_mixer(void *buffer, unsigned int n_frames) {
+    SpatialMixer *mixer = MIXER;
+    if (!mixer) return;
+
+    // the voices change only with a new listener (once per tick)
+    const AudioListener *listener = read_audio_listener(mixer->worker);
+    if (listener) update_mixer_voices(mixer, listener);
+
+    float *frames = buffer;
+    for (unsigned int i = 0; i < n_frames; i += MIXER_CHUNK_SIZE) {
+        int n = n_frames - i < MIXER_CHUNK_SIZE ? n_frames - i : MIXER_CHUNK_SIZE;
+        mix_chunk(mixer, frames + i * MIXER_N_CHANNELS, n);
+    }
+}
+
+// Each source adds up to gain, fading out quadratically with the distance. The
+// sum is capped at 1, as the single growling volume was
+static void update_mixer_voices(SpatialMixer *mixer, const AudioListener *listener) {
+    float max_d = mixer->max_distance;
+    float total_gain = 0.0;
+    mixer->n_sources = 0;
+    for (int i = 0; i < listener->n_sources; ++i) {
+        float d = Vector3Distance(listener->sources[i], listener->position);
+        if (d >= max_d) continue;
+
+        float k = (max_d - d) / max_d;
+        int j = mixer->n_sources++;
+        mixer->source_gains[j] = k * k * mixer->gain;
+        mixer->source_pans[j] = get_audio_pan(listener->position, listener->sources[i]);
+        mixer->source_delays[j] = d / max_d * MIXER_MAX_DELAY;
+        total_gain += mixer->source_gains[j];
+    }
+    float scale = total_gain > 1.0 ? 1.0 / total_gain : 1.0;
+
+    // sources below the budget share the last voice: the sum of their gains
+    // and their mean delay
+    int min_bucket = get_min_voice_bucket(mixer);
+    float shared_gain = 0.0;
+    float shared_pan = 0.0;
+    float shared_delay = 0.0;
+    mixer->n_voices = 0;
+    for (int i = 0; i < mixer->n_sources; ++i) {
+        float gain = mixer->source_gains[i] * scale;
+        if (get_gain_bucket(mixer, mixer->source_gains[i]) >= min_bucket
+            && mixer->n_voices < MAX_N_MIXER_VOICES) {
+            add_mixer_voice(mixer, gain, mixer->source_pans[i], mixer->source_delays[i]);
+        } else {
+            shared_gain += gain;
+            shared_pan += gain * mixer->source_pans[i];
+            shared_delay += gain * mixer->source_delays[i];
+        }
+    }
+    if (shared_gain > 0.0) {
+        shared_pan /= shared_gain;
+        shared_delay /= shared_gain;
+        add_mixer_voice(mixer, shared_gain, shared_pan, shared_delay);
+    }
+}
+
+// Counting by the gain: the lowest bucket whose sources, with all the louder
+// ones, still fit into the budget. 0 if all the sources fit
+static int get_min_voice_bucket(SpatialMixer *mixer) {
+    if (mixer->n_sources <= MAX_N_MIXER_VOICES) return 0;
+
+    int counts[MIXER_N_GAIN_BUCKETS] = {0};
+    for (int i = 0; i < mixer->n_sources; ++i) {
+        counts[get_gain_bucket(mixer, mixer->source_gains[i])] += 1;
+    }
+
+    int n = 0;
+    int bucket = MIXER_N_GAIN_BUCKETS;
+    while (bucket > 0 && n + counts[bucket - 1] <= MAX_N_MIXER_VOICES) {
+        n += counts[--bucket];
+    }
+
+    // the loudest bucket alone is over the budget: its first sources get the voices
+    return bucket < MIXER_N_GAIN_BUCKETS ? bucket : MIXER_N_GAIN_BUCKETS - 1;
+}
+
+static int get_gain_bucket(SpatialMixer *mixer, float gain) {
+    int bucket = gain / mixer->gain * MIXER_N_GAIN_BUCKETS;
+    return bucket < MIXER_N_GAIN_BUCKETS ? bucket : MIXER_N_GAIN_BUCKETS - 1;
+}
+
+// Equal power panning
+static void add_mixer_voice(SpatialMixer *mixer, float gain, float pan, int delay) {
+    float angle = Clamp(pan, 0.0, 1.0) * PI * 0.5;
+    int i = mixer->n_voices++;
+    mixer->gains_l[i] = gain * cosf(angle);
+    mixer->gains_r[i] = gain * sinf(angle);
+    mixer->delays[i] = delay;
+}
+
+// Replaces the frames of the music with the mix of its delayed copies
+static void mix_chunk(SpatialMixer *mixer, float *frames, int n_frames) {
+    unsigned int mask = MIXER_HISTORY_SIZE - 1;
+    unsigned int pos = mixer->history_pos;
+    for (int i = 0; i < n_frames; ++i) {
+        float *frame = &frames[i * MIXER_N_CHANNELS];
+        float sample = 0.5 * (frame[0] + frame[1]);
+        unsigned int j = (pos + i) & mask;
+        mixer->history[j] = sample;
+        mixer->history[j + MIXER_HISTORY_SIZE] = sample;
+    }
+
+    memset(mixer->mix_l, 0, n_frames * sizeof(float));
+    memset(mixer->mix_r, 0, n_frames * sizeof(float));
+    for (int v = 0; v < mixer->n_voices; ++v) {
+        const float *src = &mixer->history[(pos - mixer->delays[v]) & mask];
+        float gain_l = mixer->gains_l[v];
+        float gain_r = mixer->gains_r[v];
+        mix_voice(mixer->mix_l, mixer->mix_r, src, gain_l, gain_r, n_frames);
+    }
+    mixer->history_pos = pos + n_frames;
+
+    for (int i = 0; i < n_frames; ++i) {
+        frames[i * MIXER_N_CHANNELS] = mixer->mix_l[i];
+        frames[i * MIXER_N_CHANNELS + 1] = mixer->mix_r[i];
+    }
+}
+
+// out += src * gain, 4 frames at a time where simd is available
+static void mix_voice(
+    float *out_l, float *out_r, const float *src, float gain_l, float gain_r, int n
+) {
+    int i = 0;
+#if defined(__SSE__)
+    __m128 gl = _mm_set1_ps(gain_l);
+    __m128 gr = _mm_set1_ps(gain_r);
+    for (; i + 4 <= n; i += 4) {
+        __m128 s = _mm_loadu_ps(src + i);
+        _mm_storeu_ps(out_l + i, _mm_add_ps(_mm_loadu_ps(out_l + i), _mm_mul_ps(s, gl)));
+        _mm_storeu_ps(out_r + i, _mm_add_ps(_mm_loadu_ps(out_r + i), _mm_mul_ps(s, gr)));
+    }
+#elif defined(__wasm_simd128__)
+    v128_t gl = wasm_f32x4_splat(gain_l);
+    v128_t gr = wasm_f32x4_splat(gain_r);
+    for (; i + 4 <= n; i += 4) {
+        v128_t s = wasm_v128_load(src + i);
+        v128_t l = wasm_f32x4_add(wasm_v128_load(out_l + i), wasm_f32x4_mul(s, gl));
+        v128_t r = wasm_f32x4_add(wasm_v128_load(out_r + i), wasm_f32x4_mul(s, gr));
+        wasm_v128_store(out_l + i, l);
+        wasm_v128_store(out_r + i, r);
+    }
+#endif
+    for (; i < n; ++i) {
+        out_l[i] += src[i] * gain_l;
+        out_r[i] += src[i] * gain_r;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "audio.h"
+#include "raylib.h"
+
+#define MAX_N_MIXER_VOICES 128    // mixed one by one, the quieter ones share one more
+#define MIXER_HISTORY_SIZE 32768  // mono frames of the source signal, a power of two
+#define MIXER_MAX_DELAY 8192      // frames, of a source at max_distance
+#define MIXER_CHUNK_SIZE 256      // frames mixed at once
+#define MIXER_N_GAIN_BUCKETS 64   // to pick the loudest voices over the budget
+#define MIXER_PAN_RADIUS 5.0      // closer sources are panned less
+#define MIXER_PAN_CENTER 0.5
+
+// Spreads one looped signal (the growling) over the sound sources of the
+// listener: each source is a voice with its own stereo gains (distance and
+// pan) and delay (distance), so the horde is heard around the player and out
+// of phase. It runs as the stream processor of the music, on the audio thread.
+// The cost is bounded: the loudest MAX_N_MIXER_VOICES sources are mixed one by
+// one with simd kernels, all the others are folded into one shared voice
+typedef struct SpatialMixer {
+    AudioWorker *worker;
+    Music music;
+    float max_distance;
+    float gain;  // of one source next to the listener
+
+    // each frame is stored twice (i and i + size), so any window is contiguous
+    unsigned int history_pos;
+    float history[2 * MIXER_HISTORY_SIZE];
+
+    int n_voices;
+    float gains_l[MAX_N_MIXER_VOICES + 1];
+    float gains_r[MAX_N_MIXER_VOICES + 1];
+    int delays[MAX_N_MIXER_VOICES + 1];
+
+    // scratch: the audible sources of the latest listener and one mixed chunk
+    int n_sources;
+    float source_gains[MAX_N_AUDIO_SOURCES];
+    float source_pans[MAX_N_AUDIO_SOURCES];
+    int source_delays[MAX_N_AUDIO_SOURCES];
+    float mix_l[MIXER_CHUNK_SIZE];
+    float mix_r[MIXER_CHUNK_SIZE];
+} SpatialMixer;
+
+void attach_spatial_mixer(
+    SpatialMixer *mixer, AudioWorker *worker, Music music, float max_distance, float gain
+);
+void detach_spatial_mixer(SpatialMixer *mixer);
+float get_audio_pan(Vector3 listener, Vector3 source);
@@ -0,0 +1,225 @@
+#include "pack.h"
+
+#include "raylib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(PLATFORM_WEB)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const Pack *CALLBACKS_PACK;
+
+static bool check_pack(Pack *pack, const char *name);
+static bool write_file(FILE *f, const char *file_path, uint64_t size);
+static int compare_entries_by_path(const void *a, const void *b);
+static const char *normalize_path(const char *file_path, char *buffer);
+static unsigned char *load_file_data_callback(const char *file_name, int *data_size);
+static char *load_file_text_callback(const char *file_name);
+
+bool write_pack(Assets *assets, const char *file_path) {
+    FILE *f = fopen(file_path, "wb");
+    if (f == NULL) {
+        TraceLog(LOG_ERROR, "PACK: Failed to open %s", file_path);
+        return false;
+    }
+
+    PackHeader header = {.version = PACK_VERSION, .n_entries = assets->n};
+    memcpy(header.magic, PACK_MAGIC, 4);
+
+    // the manifest is already sorted by the file path, so is the toc
+    PackEntry *entries = calloc(assets->n, sizeof(PackEntry));
+    uint64_t offset = sizeof(PackHeader) + assets->n * sizeof(PackEntry);
+    for (int i = 0; i < assets->n; ++i) {
+        offset = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+        strcpy(entries[i].file_path, assets->assets[i].file_path);
+        entries[i].offset = offset;
+        entries[i].size = assets->assets[i].file_size;
+        offset += entries[i].size;
+    }
+
+    bool is_ok = fwrite(&header, sizeof(PackHeader), 1, f) == 1;
+    size_t n_entries = assets->n;
+    is_ok = is_ok && fwrite(entries, sizeof(PackEntry), n_entries, f) == n_entries;
+    for (int i = 0; i < assets->n && is_ok; ++i) {
+        is_ok = fseek(f, entries[i].offset, SEEK_SET) == 0
+                && write_file(f, entries[i].file_path, entries[i].size);
+    }
+
+    free(entries);
+    if (fclose(f) != 0) is_ok = false;
+    if (!is_ok) TraceLog(LOG_ERROR, "PACK: Failed to write %s", file_path);
+
+    return is_ok;
+}
+
+bool open_pack(Pack *pack, const char *file_path) {
+    memset(pack, 0, sizeof(Pack));
+
+#if !defined(PLATFORM_WEB)
+    int fd = open(file_path, O_RDONLY);
+    if (fd == -1) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(PackHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    pack->data = data;
+    pack->size = st.st_size;
+    pack->is_mapped = true;
+#else
+    // there is no mmap in the browser, the preloaded pack is read once
+    int size = 0;
+    pack->data = LoadFileData(file_path, &size);
+    pack->size = size;
+    if (pack->data == NULL) return false;
+#endif
+
+    return check_pack(pack, file_path);
+}
+
+// Same as open_pack for a pack which is already in memory (fetched by the page).
+// The pack owns the data from now on, close_pack frees it
+bool open_pack_from_memory(
+    Pack *pack, unsigned char *data, size_t size, const char *name
+) {
+    memset(pack, 0, sizeof(Pack));
+    pack->data = data;
+    pack->size = size;
+    return check_pack(pack, name);
+}
+
+void close_pack(Pack *pack) {
+#if !defined(PLATFORM_WEB)
+    if (pack->is_mapped) munmap((void *)pack->data, pack->size);
+#endif
+    if (!pack->is_mapped) UnloadFileData((unsigned char *)pack->data);
+    if (CALLBACKS_PACK == pack) set_pack_file_callbacks(NULL);
+    memset(pack, 0, sizeof(Pack));
+}
+
+// Same manifest as scan_assets gives, but the files point into the pack
+void scan_pack_assets(Assets *assets, const Pack *pack) {
+    memset(assets, 0, sizeof(Assets));
+
+    for (uint32_t i = 0; i < pack->n_entries && i < MAX_N_ASSETS; ++i) {
+        const PackEntry *entry = &pack->entries[i];
+        Asset *asset = &assets->assets[assets->n++];
+        strcpy(asset->file_path, entry->file_path);
+        asset->file_size = entry->size;
+        asset->data = pack->data + entry->offset;
+        asset->type = get_asset_type(entry->file_path);
+    }
+}
+
+const PackEntry *find_pack_entry(const Pack *pack, const char *file_path) {
+    PackEntry key;
+    normalize_path(file_path, key.file_path);
+    return bsearch(
+        &key, pack->entries, pack->n_entries, sizeof(PackEntry), compare_entries_by_path
+    );
+}
+
+// Routes LoadFileData and LoadFileText (models, shaders) to the pack. These
+// loaders get a copy, since raylib frees the data it gets from the callbacks
+void set_pack_file_callbacks(const Pack *pack) {
+    CALLBACKS_PACK = pack;
+    SetLoadFileDataCallback(pack ? load_file_data_callback : NULL);
+    SetLoadFileTextCallback(pack ? load_file_text_callback : NULL);
+}
+
+// Validates the header and the toc, closes the pack if they are broken
+static bool check_pack(Pack *pack, const char *name) {
+    const PackHeader *header = (const PackHeader *)pack->data;
+    bool is_valid = pack->size >= sizeof(PackHeader)
+                    && memcmp(header->magic, PACK_MAGIC, 4) == 0
+                    && header->version == PACK_VERSION
+                    && sizeof(PackHeader) + (size_t)header->n_entries * sizeof(PackEntry)
+                           <= pack->size;
+    if (!is_valid) {
+        TraceLog(LOG_WARNING, "PACK: %s is not a valid pack", name);
+        close_pack(pack);
+        return false;
+    }
+
+    pack->n_entries = header->n_entries;
+    pack->entries = (const PackEntry *)(pack->data + sizeof(PackHeader));
+    for (uint32_t i = 0; i < pack->n_entries; ++i) {
+        const PackEntry *entry = &pack->entries[i];
+        bool is_path_valid = memchr(entry->file_path, '\0', MAX_ASSET_PATH_LEN) != NULL;
+        if (!is_path_valid || entry->offset > pack->size
+            || entry->size > pack->size - entry->offset) {
+            TraceLog(LOG_WARNING, "PACK: %s is truncated", name);
+            close_pack(pack);
+            return false;
+        }
+    }
+
+    TraceLog(LOG_INFO, "PACK: Opened %s (%u files)", name, pack->n_entries);
+    return true;
+}
+
+static bool write_file(FILE *f, const char *file_path, uint64_t size) {
+    FILE *src = fopen(file_path, "rb");
+    if (src == NULL) return false;
+
+    char buffer[1 << 16];
+    uint64_t n_left = size;
+    while (n_left > 0) {
+        size_t n_read = n_left < sizeof(buffer) ? n_left : sizeof(buffer);
+        size_t n = fread(buffer, 1, n_read, src);
+        if (n == 0 || fwrite(buffer, 1, n, f) != n) break;
+        n_left -= n;
+    }
+    fclose(src);
+
+    return n_left == 0;
+}
+
+static int compare_entries_by_path(const void *a, const void *b) {
+    return strcmp(((const PackEntry *)a)->file_path, ((const PackEntry *)b)->file_path);
+}
+
+// Paths in the pack start with "./", as the manifest ones do
+static const char *normalize_path(const char *file_path, char *buffer) {
+    const char *prefix = strncmp(file_path, "./", 2) == 0 ? "" : "./";
+    snprintf(buffer, MAX_ASSET_PATH_LEN, "%s%s", prefix, file_path);
+    return buffer;
+}
+
+static unsigned char *load_file_data_callback(const char *file_name, int *data_size) {
+    *data_size = 0;
+    const PackEntry *entry = find_pack_entry(CALLBACKS_PACK, file_name);
+    if (entry == NULL) {
+        TraceLog(LOG_WARNING, "PACK: %s is not in the pack", file_name);
+        return NULL;
+    }
+
+    unsigned char *data = MemAlloc(entry->size);
+    memcpy(data, CALLBACKS_PACK->data + entry->offset, entry->size);
+    *data_size = entry->size;
+    return data;
+}
+
+static char *load_file_text_callback(const char *file_name) {
+    const PackEntry *entry = find_pack_entry(CALLBACKS_PACK, file_name);
+    if (entry == NULL) {
+        TraceLog(LOG_WARNING, "PACK: %s is not in the pack", file_name);
+        return NULL;
+    }
+
+    char *text = MemAlloc(entry->size + 1);
+    memcpy(text, CALLBACKS_PACK->data + entry->offset, entry->size);
+    text[entry->size] = '\0';
+    return text;
+}
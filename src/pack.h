@@ -0,0 +1,45 @@
+#pragma once
+
+#include "assets.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PACK_MAGIC "TXPK"
+#define PACK_VERSION 1
+#define PACK_ALIGNMENT 64  // of every file in the pack
+
+// Archive of the resources directory: header, table of contents sorted by the
+// file path and the aligned file contents. It's memory-mapped at runtime, and
+// the files are passed to raylib's *FromMemory loaders without copies
+typedef struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n_entries;
+    uint32_t reserved;
+} PackHeader;
+
+typedef struct PackEntry {
+    char file_path[MAX_ASSET_PATH_LEN];
+    uint64_t offset;  // from the start of the pack
+    uint64_t size;
+} PackEntry;
+
+typedef struct Pack {
+    const unsigned char *data;
+    size_t size;
+    bool is_mapped;
+
+    uint32_t n_entries;
+    const PackEntry *entries;
+} Pack;
+
+bool write_pack(Assets *assets, const char *file_path);
+bool open_pack(Pack *pack, const char *file_path);
+bool open_pack_from_memory(
+    Pack *pack, unsigned char *data, size_t size, const char *name
+);
+void close_pack(Pack *pack);
+void scan_pack_assets(Assets *assets, const Pack *pack);
+const PackEntry *find_pack_entry(const Pack *pack, const char *file_path);
+void set_pack_file_callbacks(const Pack *pack);
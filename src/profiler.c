@@ -0,0 +1,217 @@
+#include "profiler.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PROFILE_GRAPH_HEIGHT 60.0
+#define PROFILE_GRAPH_MAX_TIME (1.0 / 30.0)
+
+typedef struct ZoneStats {
+    float min;
+    float avg;
+    float p99;
+} ZoneStats;
+
+static double get_time_s(void);
+static void push_sample(Profiler *profiler, int zone, double start, double end);
+static ZoneStats get_zone_stats(const float *times, int n);
+static int compare_floats(const void *a, const void *b);
+
+void init_profiler(Profiler *profiler, const char **zone_names, int n_zones) {
+    memset(profiler, 0, sizeof(Profiler));
+    profiler->n_zones = n_zones < MAX_N_PROFILE_ZONES ? n_zones : MAX_N_PROFILE_ZONES;
+    for (int i = 0; i < profiler->n_zones; ++i) {
+        profiler->zone_names[i] = zone_names[i];
+    }
+    profiler->start_time = get_time_s();
+    profiler->frame_start = profiler->start_time;
+}
+
+void begin_profile_frame(Profiler *profiler) {
+    profiler->frame_start = get_time_s();
+    memset(profiler->zone_frame_times, 0, sizeof(profiler->zone_frame_times));
+}
+
+// Closes the frame sample and moves the zone times of the frame to the history
+void end_profile_frame(Profiler *profiler) {
+    double end = get_time_s();
+    push_sample(profiler, PROFILE_FRAME_ZONE, profiler->frame_start, end);
+
+    int k = profiler->history_idx;
+    profiler->frame_times[k] = end - profiler->frame_start;
+    for (int i = 0; i < profiler->n_zones; ++i) {
+        profiler->zone_times[i][k] = profiler->zone_frame_times[i];
+    }
+    profiler->history_idx = (k + 1) % PROFILE_N_FRAMES;
+    if (profiler->n_history < PROFILE_N_FRAMES) profiler->n_history += 1;
+    profiler->frame += 1;
+}
+
+double begin_profile_zone(Profiler *profiler) {
+    if (!profiler) return 0.0;
+    return get_time_s();
+}
+
+void end_profile_zone(Profiler *profiler, int zone, double start) {
+    if (!profiler) return;
+    double end = get_time_s();
+    profiler->zone_frame_times[zone] += end - start;
+    push_sample(profiler, zone, start, end);
+}
+
+// Per zone min, avg and p99 in ms, then the frame times graph with the 60 fps
+// line. Stats are computed only while the overlay is visible
+void draw_profiler(Profiler *profiler, Vector2 position) {
+    if (!profiler->is_overlay_visible) return;
+
+    int n = profiler->n_history;
+    int line_height = 12;
+    float width = 300.0;
+    float height = (profiler->n_zones + 3) * line_height + PROFILE_GRAPH_HEIGHT + 10.0;
+    float x = position.x;
+    float y = position.y;
+    DrawRectangle(x, y, width, height, (Color){0, 0, 0, 200});
+    x += 5.0;
+    y += 5.0;
+
+    ZoneStats frame = get_zone_stats(profiler->frame_times, n);
+    DrawText(
+        TextFormat(
+            "frame  min %.2f  avg %.2f  p99 %.2f ms", frame.min, frame.avg, frame.p99
+        ),
+        x,
+        y,
+        10,
+        WHITE
+    );
+    y += line_height;
+    DrawText("zone", x, y, 10, GRAY);
+    DrawText("min", x + 150, y, 10, GRAY);
+    DrawText("avg", x + 195, y, 10, GRAY);
+    DrawText("p99", x + 240, y, 10, GRAY);
+    y += line_height;
+
+    for (int i = 0; i < profiler->n_zones; ++i) {
+        ZoneStats stats = get_zone_stats(profiler->zone_times[i], n);
+        Color color = stats.p99 > 4.0 ? ORANGE : LIGHTGRAY;
+        DrawText(profiler->zone_names[i], x, y, 10, color);
+        DrawText(TextFormat("%.2f", stats.min), x + 150, y, 10, color);
+        DrawText(TextFormat("%.2f", stats.avg), x + 195, y, 10, color);
+        DrawText(TextFormat("%.2f", stats.p99), x + 240, y, 10, color);
+        y += line_height;
+    }
+
+    // oldest frame on the left
+    y += 5.0;
+    float bar_width = (width - 10.0) / PROFILE_N_FRAMES;
+    for (int k = 0; k < n; ++k) {
+        int idx = (profiler->history_idx - n + k + PROFILE_N_FRAMES) % PROFILE_N_FRAMES;
+        float t = profiler->frame_times[idx];
+        float h = fminf(t / PROFILE_GRAPH_MAX_TIME, 1.0) * PROFILE_GRAPH_HEIGHT;
+        Color color = t > 1.0 / 55.0 ? RED : GREEN;
+        DrawRectangle(
+            x + k * bar_width, y + PROFILE_GRAPH_HEIGHT - h, bar_width + 1, h, color
+        );
+    }
+    float line_y = y + PROFILE_GRAPH_HEIGHT
+                   - (1.0 / 60.0) / PROFILE_GRAPH_MAX_TIME * PROFILE_GRAPH_HEIGHT;
+    DrawLine(x, line_y, x + width - 10.0, line_y, ColorAlpha(WHITE, 0.5));
+}
+
+// Chrome trace event format (chrome://tracing, ui.perfetto.dev): one complete
+// event per sample still in the ring
+bool save_profile_trace(Profiler *profiler, const char *file_path) {
+    FILE *file = fopen(file_path, "w");
+    if (!file) {
+        TraceLog(LOG_WARNING, "PROFILER: Failed to open %s", file_path);
+        return false;
+    }
+
+#if !defined(PLATFORM_WEB)
+    unsigned int n_written = atomic_load_explicit(
+        &profiler->n_written, memory_order_acquire
+    );
+#else
+    unsigned int n_written = profiler->n_written;
+#endif
+    unsigned int first = n_written > PROFILE_RING_SIZE ? n_written - PROFILE_RING_SIZE
+                                                       : 0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (unsigned int i = first; i < n_written; ++i) {
+        const ProfileSample *sample = &profiler->samples[i & (PROFILE_RING_SIZE - 1)];
+        const char *name = sample->zone == PROFILE_FRAME_ZONE
+                               ? "frame"
+                               : profiler->zone_names[sample->zone];
+        fprintf(
+            file,
+            "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,"
+            "\"tid\":1,\"args\":{\"frame\":%u}}%s\n",
+            name,
+            sample->start * 1e6,
+            sample->duration * 1e6,
+            sample->frame,
+            i + 1 < n_written ? "," : ""
+        );
+    }
+    fprintf(file, "]}\n");
+    fclose(file);
+
+    TraceLog(
+        LOG_INFO, "PROFILER: Saved %u samples to %s", n_written - first, file_path
+    );
+    return true;
+}
+
+static double get_time_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Single producer: the sample is written before the count which publishes it
+static void push_sample(Profiler *profiler, int zone, double start, double end) {
+#if !defined(PLATFORM_WEB)
+    unsigned int n = atomic_load_explicit(&profiler->n_written, memory_order_relaxed);
+#else
+    unsigned int n = profiler->n_written;
+#endif
+    profiler->samples[n & (PROFILE_RING_SIZE - 1)] = (ProfileSample){
+        .frame = profiler->frame,
+        .zone = zone,
+        .start = start - profiler->start_time,
+        .duration = end - start,
+    };
+#if !defined(PLATFORM_WEB)
+    atomic_store_explicit(&profiler->n_written, n + 1, memory_order_release);
+#else
+    profiler->n_written = n + 1;
+#endif
+}
+
+static ZoneStats get_zone_stats(const float *times, int n) {
+    ZoneStats stats = {0};
+    if (n == 0) return stats;
+
+    float sorted[PROFILE_N_FRAMES];
+    memcpy(sorted, times, sizeof(float) * n);
+    qsort(sorted, n, sizeof(float), compare_floats);
+
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) sum += sorted[i];
+    int p99_idx = (n * 99 + 99) / 100 - 1;
+
+    stats.min = sorted[0] * 1e3;
+    stats.avg = sum / n * 1e3;
+    stats.p99 = sorted[p99_idx] * 1e3;
+    return stats;
+}
+
+static int compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
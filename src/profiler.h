@@ -0,0 +1,59 @@
+#pragma once
+
+#include "raylib.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#if !defined(PLATFORM_WEB)
+#include <stdatomic.h>
+#endif
+
+#define MAX_N_PROFILE_ZONES 32
+#define PROFILE_RING_SIZE 65536  // samples, a power of two (~40 s of the game)
+#define PROFILE_N_FRAMES 240     // history of the overlay stats and graph
+#define PROFILE_FRAME_ZONE 0xff  // zone of the whole frame samples
+
+typedef struct ProfileSample {
+    uint32_t frame;
+    uint8_t zone;
+    double start;    // s, since init_profiler
+    float duration;  // s
+} ProfileSample;
+
+// Timers of the main thread. Each begin/end pair appends a sample to the ring
+// buffer (the write count is published with a release store, so a reader on
+// another thread needs no lock) and adds up to the zone time of the frame.
+// The overlay shows min, avg and p99 of the last PROFILE_N_FRAMES frames
+typedef struct Profiler {
+    bool is_overlay_visible;
+    int n_zones;
+    const char *zone_names[MAX_N_PROFILE_ZONES];
+
+    double start_time;
+    double frame_start;
+    uint32_t frame;
+
+#if !defined(PLATFORM_WEB)
+    atomic_uint n_written;  // in total, the ring keeps the last PROFILE_RING_SIZE
+#else
+    unsigned int n_written;
+#endif
+    ProfileSample samples[PROFILE_RING_SIZE];
+
+    float zone_frame_times[MAX_N_PROFILE_ZONES];  // of the current frame
+    int n_history;
+    int history_idx;
+    float frame_times[PROFILE_N_FRAMES];
+    float zone_times[MAX_N_PROFILE_ZONES][PROFILE_N_FRAMES];
+} Profiler;
+
+void init_profiler(Profiler *profiler, const char **zone_names, int n_zones);
+void begin_profile_frame(Profiler *profiler);
+void end_profile_frame(Profiler *profiler);
+
+// A NULL profiler (headless and batch runs) makes both no-ops
+double begin_profile_zone(Profiler *profiler);
+void end_profile_zone(Profiler *profiler, int zone, double start);
+
+void draw_profiler(Profiler *profiler, Vector2 position);
+bool save_profile_trace(Profiler *profiler, const char *file_path);
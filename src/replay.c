@@ -0,0 +1,196 @@
+#include "replay.h"
+
+#include "raylib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HAS_CHAR_BIT (1 << 7)
+
+static void push_byte(Replay *replay, unsigned char byte);
+static void push_varint(Replay *replay, uint32_t value);
+static uint32_t read_varint(Replay *replay);
+
+void init_replay(Replay *replay, uint64_t seed, uint32_t tick_rate, bool has_hashes) {
+    memset(replay, 0, sizeof(Replay));
+    replay->seed = seed;
+    replay->tick_rate = tick_rate;
+    replay->has_hashes = has_hashes;
+}
+
+void unload_replay(Replay *replay) {
+    free(replay->data);
+    free(replay->hashes);
+    memset(replay, 0, sizeof(Replay));
+}
+
+bool save_replay(const Replay *replay, const char *file_path) {
+    FILE *f = fopen(file_path, "wb");
+    if (f == NULL) {
+        TraceLog(LOG_WARNING, "REPLAY: Failed to open %s", file_path);
+        return false;
+    }
+
+    ReplayHeader header = {
+        .magic = REPLAY_MAGIC,
+        .version = REPLAY_VERSION,
+        .seed = replay->seed,
+        .tick_rate = replay->tick_rate,
+        .n_ticks = replay->n_ticks,
+        .n_hashes = replay->has_hashes ? replay->n_ticks : 0,
+        .data_size = replay->size,
+    };
+    bool is_ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    if (is_ok && replay->size > 0) {
+        is_ok = fwrite(replay->data, replay->size, 1, f) == 1;
+    }
+    if (is_ok && header.n_hashes > 0) {
+        is_ok = fwrite(replay->hashes, sizeof(uint32_t), header.n_hashes, f)
+                == header.n_hashes;
+    }
+    fclose(f);
+
+    if (is_ok) {
+        TraceLog(
+            LOG_INFO,
+            "REPLAY: Saved %d ticks to %s (%u input bytes)",
+            replay->n_ticks,
+            file_path,
+            header.data_size
+        );
+    } else {
+        TraceLog(LOG_WARNING, "REPLAY: Failed to write %s", file_path);
+    }
+    return is_ok;
+}
+
+bool load_replay(Replay *replay, const char *file_path) {
+    memset(replay, 0, sizeof(Replay));
+    FILE *f = fopen(file_path, "rb");
+    if (f == NULL) {
+        TraceLog(LOG_WARNING, "REPLAY: Failed to open %s", file_path);
+        return false;
+    }
+
+    ReplayHeader header;
+    bool is_ok = fread(&header, sizeof(header), 1, f) == 1
+                 && memcmp(header.magic, REPLAY_MAGIC, 4) == 0
+                 && header.version == REPLAY_VERSION && header.tick_rate > 0
+                 && (header.n_hashes == 0 || header.n_hashes == header.n_ticks);
+    if (is_ok) {
+        replay->seed = header.seed;
+        replay->tick_rate = header.tick_rate;
+        replay->n_ticks = header.n_ticks;
+        replay->has_hashes = header.n_hashes > 0;
+        replay->size = header.data_size;
+        replay->capacity = header.data_size;
+        replay->data = malloc(header.data_size + 1);
+        replay->hashes = malloc(sizeof(uint32_t) * header.n_hashes + 1);
+        is_ok = fread(replay->data, 1, header.data_size, f) == header.data_size
+                && fread(replay->hashes, sizeof(uint32_t), header.n_hashes, f)
+                       == header.n_hashes;
+    }
+    fclose(f);
+
+    if (!is_ok) {
+        TraceLog(LOG_WARNING, "REPLAY: %s is not a valid replay", file_path);
+        unload_replay(replay);
+        return false;
+    }
+
+    if (replay->size > 0) replay->record_tick = read_varint(replay);
+    return true;
+}
+
+// Writes a record only when the input differs from the last record's one
+void record_replay_tick(Replay *replay, ReplayInput input, uint32_t hash) {
+    int tick = replay->n_ticks++;
+
+    if (replay->has_hashes) {
+        // the capacity doubles at every power of two
+        if ((tick & (tick - 1)) == 0) {
+            size_t capacity = tick == 0 ? 1 : 2 * tick;
+            replay->hashes = realloc(replay->hashes, sizeof(uint32_t) * capacity);
+        }
+        replay->hashes[tick] = hash;
+    }
+
+    bool is_first = replay->size == 0;
+    if (!is_first && input.keys == replay->input.keys && input.pressed_char == 0) {
+        return;
+    }
+
+    push_varint(replay, tick - replay->record_tick);
+    uint8_t keys = input.keys & ~HAS_CHAR_BIT;
+    if (input.pressed_char != 0) keys |= HAS_CHAR_BIT;
+    push_byte(replay, keys);
+    if (input.pressed_char != 0) push_varint(replay, input.pressed_char);
+
+    replay->record_tick = tick;
+    replay->input = input;
+}
+
+bool is_replay_finished(const Replay *replay) {
+    return replay->tick >= replay->n_ticks;
+}
+
+// Input of the next tick: the record of this tick, or the keys of the last one
+ReplayInput next_replay_input(Replay *replay) {
+    ReplayInput input = {.keys = replay->input.keys, .pressed_char = 0};
+
+    if (replay->read_pos < replay->size && replay->tick == replay->record_tick) {
+        uint8_t keys = replay->data[replay->read_pos++];
+        input.keys = keys & ~HAS_CHAR_BIT;
+        if (keys & HAS_CHAR_BIT) input.pressed_char = read_varint(replay);
+        replay->input = input;
+
+        if (replay->read_pos < replay->size) replay->record_tick += read_varint(replay);
+    }
+
+    replay->tick += 1;
+    return input;
+}
+
+bool check_replay_hash(const Replay *replay, int tick, uint32_t hash) {
+    if (!replay->has_hashes || tick >= replay->n_ticks) return true;
+    return replay->hashes[tick] == hash;
+}
+
+// FNV-1a
+uint32_t hash_replay_data(uint32_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void push_byte(Replay *replay, unsigned char byte) {
+    if (replay->size == replay->capacity) {
+        replay->capacity = replay->capacity == 0 ? 256 : 2 * replay->capacity;
+        replay->data = realloc(replay->data, replay->capacity);
+    }
+    replay->data[replay->size++] = byte;
+}
+
+// LEB128: 7 bits per byte, the high bit is set on all but the last one
+static void push_varint(Replay *replay, uint32_t value) {
+    while (value >= 0x80) {
+        push_byte(replay, (value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    push_byte(replay, value);
+}
+
+static uint32_t read_varint(Replay *replay) {
+    uint32_t value = 0;
+    int shift = 0;
+    while (replay->read_pos < replay->size && shift < 32) {
+        unsigned char byte = replay->data[replay->read_pos++];
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) break;
+        shift += 7;
+    }
+    return value;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define REPLAY_MAGIC "TXRP"
+#define REPLAY_VERSION 5
+#define REPLAY_HASH_INIT 2166136261u
+
+// Keys of one tick: pressed ones are events of this tick, the arrows are held
+#define REPLAY_KEY_ENTER (1 << 0)
+#define REPLAY_KEY_BACKSPACE (1 << 1)
+#define REPLAY_KEY_EXIT (1 << 2)
+#define REPLAY_KEY_UP (1 << 3)
+#define REPLAY_KEY_DOWN (1 << 4)
+#define REPLAY_KEY_LEFT (1 << 5)
+#define REPLAY_KEY_RIGHT (1 << 6)
+
+typedef struct ReplayInput {
+    uint8_t keys;
+    int pressed_char;
+} ReplayInput;
+
+typedef struct ReplayHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t seed;
+    uint32_t tick_rate;
+    uint32_t n_ticks;
+    uint32_t n_hashes;  // 0 or n_ticks
+    uint32_t data_size;
+} ReplayHeader;
+
+// Seed and the per-tick input of a session. Only the ticks where the input
+// changes are stored: a varint tick delta, the keys byte (the high bit tells
+// that a char follows) and the char as a varint. Optional per-tick hashes of
+// the world follow the input, so a replay reports where it diverges
+typedef struct Replay {
+    uint64_t seed;
+    uint32_t tick_rate;
+    bool has_hashes;
+
+    int n_ticks;
+    size_t size;
+    size_t capacity;
+    unsigned char *data;
+    uint32_t *hashes;
+
+    // tick of the last written (or the next read) record and its input
+    int record_tick;
+    ReplayInput input;
+
+    // playback cursor
+    int tick;
+    size_t read_pos;
+} Replay;
+
+void init_replay(Replay *replay, uint64_t seed, uint32_t tick_rate, bool has_hashes);
+void unload_replay(Replay *replay);
+bool save_replay(const Replay *replay, const char *file_path);
+bool load_replay(Replay *replay, const char *file_path);
+
+void record_replay_tick(Replay *replay, ReplayInput input, uint32_t hash);
+bool is_replay_finished(const Replay *replay);
+ReplayInput next_replay_input(Replay *replay);
+bool check_replay_hash(const Replay *replay, int tick, uint32_t hash);
+
+uint32_t hash_replay_data(uint32_t hash, const void *data, size_t size);
@@ -0,0 +1,57 @@
+#include "rng.h"
+
+#define PCG_MULTIPLIER 6364136223846793005ULL
+
+Rng rng_seed(uint64_t seed, uint64_t stream) {
+    Rng rng = {.state = 0, .inc = (stream << 1) | 1};
+    rng_next(&rng);
+    rng.state += seed;
+    rng_next(&rng);
+    return rng;
+}
+
+uint32_t rng_next(Rng *rng) {
+    uint64_t state = rng->state;
+    rng->state = state * PCG_MULTIPLIER + rng->inc;
+    uint32_t xorshifted = ((state >> 18) ^ state) >> 27;
+    uint32_t rot = state >> 59;
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+// [0, 1) from the top 24 bits, a multiply instead of a division by RAND_MAX
+float rng_float(Rng *rng) {
+    return (rng_next(rng) >> 8) * 0x1.0p-24f;
+}
+
+// [-1, 1)
+float rng_centered(Rng *rng) {
+    return rng_float(rng) * 2.0f - 1.0f;
+}
+
+float rng_range(Rng *rng, float left, float right) {
+    return left + rng_float(rng) * (right - left);
+}
+
+// [min, max], inclusive as GetRandomValue. Multiply-shift reduction, no modulo
+int rng_int(Rng *rng, int min, int max) {
+    if (max <= min) return min;
+    uint64_t range = (uint64_t)(max - min) + 1;
+    return min + (int)((rng_next(rng) * range) >> 32);
+}
+
+void rng_fill_u32(Rng *rng, uint32_t *out, int n) {
+    for (int i = 0; i < n; ++i) out[i] = rng_next(rng);
+}
+
+// The state update is a serial dependency, the conversion is done in a
+// second branch-free pass over each chunk which the compiler vectorizes
+void rng_fill_floats(Rng *rng, float *out, int n) {
+    uint32_t bits[64];
+    for (int start = 0; start < n; start += 64) {
+        int n_chunk = n - start < 64 ? n - start : 64;
+        rng_fill_u32(rng, bits, n_chunk);
+        for (int i = 0; i < n_chunk; ++i) {
+            out[start + i] = (bits[i] >> 8) * 0x1.0p-24f;
+        }
+    }
+}
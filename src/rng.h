@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+// Independent sequences of one seed: the gameplay one is advanced only by the
+// simulation, the cosmetic one by sounds and camera shake, so the presentation
+// never changes the outcome of a game
+#define RNG_STREAM_GAMEPLAY 0
+#define RNG_STREAM_COSMETIC 1
+
+// PCG32 (XSH RR): 64 bit state, 32 bit output. Cheap enough to keep one per
+// world, so worlds don't share raylib's global generator
+typedef struct Rng {
+    uint64_t state;
+    uint64_t inc;  // odd, selects the stream
+} Rng;
+
+Rng rng_seed(uint64_t seed, uint64_t stream);
+uint32_t rng_next(Rng *rng);
+float rng_float(Rng *rng);
+float rng_centered(Rng *rng);
+float rng_range(Rng *rng, float left, float right);
+int rng_int(Rng *rng, int min, int max);
+
+void rng_fill_u32(Rng *rng, uint32_t *out, int n);
+void rng_fill_floats(Rng *rng, float *out, int n);
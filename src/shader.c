@@ -1,19 +1,125 @@
 #include "shader.h"
 
+#include "rlgl.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static char *load_shader_src(const char *file_name);
+#if !defined(PLATFORM_WEB)
+#include <sys/stat.h>
 
-Shader load_shader(const char *vs_file_name, const char *fs_file_name) {
-    char *vs = NULL;
-    char *fs = NULL;
+// raylib doesn't expose program binaries, the entry points are fetched from
+// the glfw linked into it
+#define GL_VENDOR 0x1F00
+#define GL_RENDERER 0x1F01
+#define GL_VERSION 0x1F02
+#define GL_LINK_STATUS 0x8B82
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
 
-    if (vs_file_name) vs = load_shader_src(vs_file_name);
-    else vs = load_shader_src("base.vert");
+typedef void (*GLProc)(void);
+GLProc glfwGetProcAddress(const char *name);
 
-    if (fs_file_name) fs = load_shader_src(fs_file_name);
-    Shader shader = LoadShaderFromMemory(vs, fs);
+typedef const unsigned char *(*GLGetString)(unsigned int name);
+typedef void (*GLGetIntegerv)(unsigned int name, int *data);
+typedef void (*GLGetProgramiv)(unsigned int program, unsigned int name, int *params);
+typedef unsigned int (*GLCreateProgram)(void);
+typedef void (*GLGetProgramBinary)(
+    unsigned int program, int size, int *length, unsigned int *format, void *binary
+);
+typedef void (*GLProgramBinary)(
+    unsigned int program, unsigned int format, const void *binary, int length
+);
+
+static struct {
+    GLGetString get_string;
+    GLGetIntegerv get_integerv;
+    GLGetProgramiv get_programiv;
+    GLCreateProgram create_program;
+    GLGetProgramBinary get_program_binary;
+    GLProgramBinary program_binary;
+} GL;
+
+static unsigned int load_cached_program(uint64_t hash);
+static void save_program_binary(unsigned int program, uint64_t hash);
+static Shader get_program_shader(unsigned int program);
+#endif
+
+static const char *get_version(void);
+static char *load_shader_src(Shaders *shaders, const char *file_name);
+static uint64_t hash_str(uint64_t hash, const char *str);
+
+void init_shaders(Shaders *shaders) {
+    memset(shaders, 0, sizeof(Shaders));
+    shaders->common = LoadFileText("resources/shaders/common.glsl");
+    shaders->driver_hash = hash_str(14695981039346656037ULL, get_version());
+
+#if !defined(PLATFORM_WEB)
+    GL.get_string = (GLGetString)glfwGetProcAddress("glGetString");
+    GL.get_integerv = (GLGetIntegerv)glfwGetProcAddress("glGetIntegerv");
+    GL.get_programiv = (GLGetProgramiv)glfwGetProcAddress("glGetProgramiv");
+    GL.create_program = (GLCreateProgram)glfwGetProcAddress("glCreateProgram");
+    GL.get_program_binary = (GLGetProgramBinary)glfwGetProcAddress("glGetProgramBinary");
+    GL.program_binary = (GLProgramBinary)glfwGetProcAddress("glProgramBinary");
+    if (!GL.get_string || !GL.get_integerv || !GL.get_programiv || !GL.create_program
+        || !GL.get_program_binary || !GL.program_binary) {
+        TraceLog(LOG_WARNING, "SHADER: Program binaries aren't supported");
+        return;
+    }
+
+    int n_formats = 0;
+    GL.get_integerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n_formats);
+    if (n_formats == 0) {
+        TraceLog(LOG_WARNING, "SHADER: The driver has no program binary formats");
+        return;
+    }
+
+    // binaries are only valid for the driver which produced them
+    unsigned int names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (int i = 0; i < 3; ++i) {
+        const char *str = (const char *)GL.get_string(names[i]);
+        if (str) shaders->driver_hash = hash_str(shaders->driver_hash, str);
+    }
+
+    mkdir(SHADER_CACHE_DIR, 0755);
+    shaders->is_binary_cache_enabled = true;
+#endif
+}
+
+void unload_shaders(Shaders *shaders) {
+    if (shaders->common) UnloadFileText(shaders->common);
+    shaders->common = NULL;
+}
+
+Shader load_shader(Shaders *shaders, const char *vs_file_name, const char *fs_file_name) {
+    char *vs = load_shader_src(shaders, vs_file_name ? vs_file_name : "base.vert");
+    char *fs = fs_file_name ? load_shader_src(shaders, fs_file_name) : NULL;
+
+    // the vertex and fragment parts are hashed separately, so the same text
+    // in a different stage gives a different key
+    uint64_t hash = hash_str(shaders->driver_hash, vs ? vs : "");
+    hash = hash_str(hash ^ 0x9e3779b97f4a7c15ULL, fs ? fs : "");
+
+    Shader shader = {0};
+#if !defined(PLATFORM_WEB)
+    if (shaders->is_binary_cache_enabled) {
+        unsigned int program = load_cached_program(hash);
+        if (program > 0) {
+            shader = get_program_shader(program);
+            shaders->n_cached += 1;
+        }
+    }
+#endif
+
+    if (shader.id == 0) {
+        shader = LoadShaderFromMemory(vs, fs);
+        shaders->n_compiled += 1;
+#if !defined(PLATFORM_WEB)
+        if (shaders->is_binary_cache_enabled && shader.id != rlGetShaderIdDefault()) {
+            save_program_binary(shader.id, hash);
+        }
+#endif
+    }
 
     if (vs) free(vs);
     if (fs) free(fs);
@@ -21,35 +127,168 @@ Shader load_shader(const char *vs_file_name, const char *fs_file_name) {
     return shader;
 }
 
-static char *load_shader_src(const char *file_name) {
+UniformFloat get_uniform_float(Shader shader, const char *name) {
+    return (UniformFloat){shader.id, rlGetLocationUniform(shader.id, name)};
+}
 
-    const char *version;
+UniformVec2 get_uniform_vec2(Shader shader, const char *name) {
+    return (UniformVec2){shader.id, rlGetLocationUniform(shader.id, name)};
+}
+
+UniformMat4 get_uniform_mat4(Shader shader, const char *name) {
+    return (UniformMat4){shader.id, rlGetLocationUniform(shader.id, name)};
+}
 
+void set_uniform_float(UniformFloat uniform, float value) {
+    rlEnableShader(uniform.shader_id);
+    rlSetUniform(uniform.loc, &value, RL_SHADER_UNIFORM_FLOAT, 1);
+}
+
+void set_uniform_vec2(UniformVec2 uniform, Vector2 value) {
+    rlEnableShader(uniform.shader_id);
+    rlSetUniform(uniform.loc, &value, RL_SHADER_UNIFORM_VEC2, 1);
+}
+
+void set_uniform_mat4(UniformMat4 uniform, Matrix value) {
+    rlEnableShader(uniform.shader_id);
+    rlSetUniformMatrix(uniform.loc, value);
+}
+
+static const char *get_version(void) {
 #if defined(PLATFORM_WEB)
-    version = "#version 300 es\n\nprecision highp float;";
+    return "#version 300 es\n\nprecision highp float;";
 #else
-    version = "#version 460 core";
+    return "#version 460 core";
 #endif
+}
 
-    char *common = LoadFileText("resources/shaders/common.glsl");
+static char *load_shader_src(Shaders *shaders, const char *file_name) {
     char *text = LoadFileText(TextFormat("resources/shaders/%s", file_name));
+    if (text == NULL) return NULL;
 
-    char *src = malloc(strlen(version) + strlen(common) + strlen(text) + 6);
+    const char *version = get_version();
+    const char *common = shaders->common ? shaders->common : "";
+    size_t version_len = strlen(version);
+    size_t common_len = strlen(common);
+    size_t text_len = strlen(text);
 
-    int p = 0;
+    char *src = malloc(version_len + common_len + text_len + 3);
+    char *p = src;
+    memcpy(p, version, version_len);
+    p += version_len;
+    *p++ = '\n';
+    memcpy(p, common, common_len);
+    p += common_len;
+    *p++ = '\n';
+    memcpy(p, text, text_len + 1);
 
-    strcpy(&src[p], version);
-    p += strlen(version);
-    src[p++] = '\n';
+    UnloadFileText(text);
 
-    strcpy(&src[p], common);
-    p += strlen(common);
-    src[p++] = '\n';
+    return src;
+}
 
-    strcpy(&src[p], text);
+// FNV-1a
+static uint64_t hash_str(uint64_t hash, const char *str) {
+    for (const unsigned char *p = (const unsigned char *)str; *p; ++p) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
 
-    UnloadFileText(common);
-    UnloadFileText(text);
+#if !defined(PLATFORM_WEB)
+static void get_cache_file_path(uint64_t hash, char *file_path) {
+    unsigned long long key = hash;
+    snprintf(file_path, 256, "%s/%016llx.bin", SHADER_CACHE_DIR, key);
+}
 
-    return src;
+// Cached file: the binary format followed by the program binary
+static unsigned int load_cached_program(uint64_t hash) {
+    char file_path[256];
+    get_cache_file_path(hash, file_path);
+    FILE *f = fopen(file_path, "rb");
+    if (f == NULL) return 0;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f) - (long)sizeof(unsigned int);
+    fseek(f, 0, SEEK_SET);
+
+    unsigned int program = 0;
+    unsigned int format;
+    void *binary = size > 0 ? malloc(size) : NULL;
+    if (binary && fread(&format, sizeof(format), 1, f) == 1
+        && fread(binary, size, 1, f) == 1) {
+        program = GL.create_program();
+        GL.program_binary(program, format, binary, size);
+
+        // rejected after a driver update, it's compiled and cached again
+        int is_linked = 0;
+        GL.get_programiv(program, GL_LINK_STATUS, &is_linked);
+        if (!is_linked) {
+            rlUnloadShaderProgram(program);
+            program = 0;
+        }
+    }
+    free(binary);
+    fclose(f);
+
+    return program;
+}
+
+static void save_program_binary(unsigned int program, uint64_t hash) {
+    int size = 0;
+    GL.get_programiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) return;
+
+    void *binary = malloc(size);
+    unsigned int format;
+    GL.get_program_binary(program, size, &size, &format, binary);
+
+    char file_path[256];
+    get_cache_file_path(hash, file_path);
+    FILE *f = fopen(file_path, "wb");
+    if (f) {
+        fwrite(&format, sizeof(format), 1, f);
+        fwrite(binary, size, 1, f);
+        fclose(f);
+    } else {
+        TraceLog(LOG_WARNING, "SHADER: Failed to write %s", file_path);
+    }
+    free(binary);
 }
+
+// Same default locations LoadShaderFromMemory resolves
+static Shader get_program_shader(unsigned int program) {
+    Shader shader = {program, MemAlloc(RL_MAX_SHADER_LOCATIONS * sizeof(int))};
+    for (int i = 0; i < RL_MAX_SHADER_LOCATIONS; ++i) shader.locs[i] = -1;
+
+    struct {
+        int idx;
+        const char *name;
+        bool is_attrib;
+    } locs[] = {
+        {SHADER_LOC_VERTEX_POSITION, RL_DEFAULT_SHADER_ATTRIB_NAME_POSITION, true},
+        {SHADER_LOC_VERTEX_TEXCOORD01, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD, true},
+        {SHADER_LOC_VERTEX_TEXCOORD02, RL_DEFAULT_SHADER_ATTRIB_NAME_TEXCOORD2, true},
+        {SHADER_LOC_VERTEX_NORMAL, RL_DEFAULT_SHADER_ATTRIB_NAME_NORMAL, true},
+        {SHADER_LOC_VERTEX_TANGENT, RL_DEFAULT_SHADER_ATTRIB_NAME_TANGENT, true},
+        {SHADER_LOC_VERTEX_COLOR, RL_DEFAULT_SHADER_ATTRIB_NAME_COLOR, true},
+        {SHADER_LOC_MATRIX_MVP, RL_DEFAULT_SHADER_UNIFORM_NAME_MVP, false},
+        {SHADER_LOC_MATRIX_VIEW, RL_DEFAULT_SHADER_UNIFORM_NAME_VIEW, false},
+        {SHADER_LOC_MATRIX_PROJECTION, RL_DEFAULT_SHADER_UNIFORM_NAME_PROJECTION, false},
+        {SHADER_LOC_MATRIX_MODEL, RL_DEFAULT_SHADER_UNIFORM_NAME_MODEL, false},
+        {SHADER_LOC_MATRIX_NORMAL, RL_DEFAULT_SHADER_UNIFORM_NAME_NORMAL, false},
+        {SHADER_LOC_COLOR_DIFFUSE, RL_DEFAULT_SHADER_UNIFORM_NAME_COLOR, false},
+        {SHADER_LOC_MAP_ALBEDO, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE0, false},
+        {SHADER_LOC_MAP_METALNESS, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE1, false},
+        {SHADER_LOC_MAP_NORMAL, RL_DEFAULT_SHADER_SAMPLER2D_NAME_TEXTURE2, false},
+    };
+    for (int i = 0; i < (int)(sizeof(locs) / sizeof(locs[0])); ++i) {
+        shader.locs[locs[i].idx] = locs[i].is_attrib
+                                       ? rlGetLocationAttrib(program, locs[i].name)
+                                       : rlGetLocationUniform(program, locs[i].name);
+    }
+
+    return shader;
+}
+#endif
@@ -1,5 +1,47 @@
 #pragma once
 
 #include "raylib.h"
+#include <stdbool.h>
+#include <stdint.h>
 
-Shader load_shader(const char *vs_file_name, const char *fs_file_name);
+#define SHADER_CACHE_DIR "./shader_cache"
+
+// Uniform handles are resolved once when the shader is loaded, so setting
+// them in the frame loop doesn't look the names up
+typedef struct UniformFloat {
+    unsigned int shader_id;
+    int loc;
+} UniformFloat;
+
+typedef struct UniformVec2 {
+    unsigned int shader_id;
+    int loc;
+} UniformVec2;
+
+typedef struct UniformMat4 {
+    unsigned int shader_id;
+    int loc;
+} UniformMat4;
+
+// Shaders are compiled with the common.glsl prelude, which is read once.
+// On desktop the linked programs are also cached as driver binaries, keyed by
+// a hash of the sources and the driver, so warm starts skip the compilation
+typedef struct Shaders {
+    char *common;
+    uint64_t driver_hash;
+    bool is_binary_cache_enabled;
+
+    int n_cached;
+    int n_compiled;
+} Shaders;
+
+void init_shaders(Shaders *shaders);
+void unload_shaders(Shaders *shaders);
+Shader load_shader(Shaders *shaders, const char *vs_file_name, const char *fs_file_name);
+
+UniformFloat get_uniform_float(Shader shader, const char *name);
+UniformVec2 get_uniform_vec2(Shader shader, const char *name);
+UniformMat4 get_uniform_mat4(Shader shader, const char *name);
+void set_uniform_float(UniformFloat uniform, float value);
+void set_uniform_vec2(UniformVec2 uniform, Vector2 value);
+void set_uniform_mat4(UniformMat4 uniform, Matrix value);
@@ -0,0 +1,112 @@
+#include "sprite_batch.h"
+
+#include "raymath.h"
+#include "rlgl.h"
+#include <stddef.h>
+
+static void set_instance_attribute(
+    unsigned int shader_id, const char *name, int size, int type, size_t offset
+);
+
+void init_sprite_batch(SpriteBatch *batch, Shader shader, Texture2D texture, float size) {
+    batch->shader = shader;
+    batch->texture = texture;
+    batch->mvp = get_uniform_mat4(shader, "mvp");
+    batch->time = get_uniform_float(shader, "u_time");
+    batch->n = 0;
+
+    // same layout as GenMeshPlane(size, size): the quad lies in xz and
+    // the shader lays it on the ground, v grows towards -z (up the screen)
+    float h = 0.5 * size;
+    float quad[] = {
+        -h, 0.0, -h, 0.0, 0.0,  //
+        -h, 0.0, h,  0.0, 1.0,  //
+        h,  0.0, h,  1.0, 1.0,  //
+        -h, 0.0, -h, 0.0, 0.0,  //
+        h,  0.0, h,  1.0, 1.0,  //
+        h,  0.0, -h, 1.0, 0.0,  //
+    };
+    int stride = 5 * sizeof(float);
+
+    batch->vao = rlLoadVertexArray();
+    rlEnableVertexArray(batch->vao);
+
+    batch->quad_vbo = rlLoadVertexBuffer(quad, sizeof(quad), false);
+    int position_loc = rlGetLocationAttrib(shader.id, "vertexPosition");
+    int uv_loc = rlGetLocationAttrib(shader.id, "vertexTexCoord");
+    rlSetVertexAttribute(position_loc, 3, RL_FLOAT, false, stride, (void *)0);
+    rlEnableVertexAttribute(position_loc);
+    rlSetVertexAttribute(uv_loc, 2, RL_FLOAT, false, stride, (void *)(3 * sizeof(float)));
+    rlEnableVertexAttribute(uv_loc);
+
+    batch->instance_vbo = rlLoadVertexBuffer(NULL, sizeof(batch->instances), true);
+    set_instance_attribute(
+        shader.id, "instancePosition", 4, RL_FLOAT, offsetof(SpriteInstance, position)
+    );
+    set_instance_attribute(
+        shader.id, "instanceRegion", 4, RL_FLOAT, offsetof(SpriteInstance, region)
+    );
+    set_instance_attribute(
+        shader.id, "instanceAnimation", 4, RL_FLOAT, offsetof(SpriteInstance, animation)
+    );
+    set_instance_attribute(
+        shader.id, "instanceColor", 4, RL_UNSIGNED_BYTE, offsetof(SpriteInstance, color)
+    );
+
+    rlDisableVertexArray();
+}
+
+void unload_sprite_batch(SpriteBatch *batch) {
+    rlUnloadVertexBuffer(batch->instance_vbo);
+    rlUnloadVertexBuffer(batch->quad_vbo);
+    rlUnloadVertexArray(batch->vao);
+    UnloadShader(batch->shader);
+}
+
+void push_sprite(SpriteBatch *batch, SpriteInstance instance) {
+    if (batch->n == MAX_N_SPRITE_INSTANCES) return;
+    batch->instances[batch->n++] = instance;
+}
+
+// Draws the pushed sprites in the push order with the current 3d camera
+// and empties the batch
+void draw_sprite_batch(SpriteBatch *batch, float time) {
+    if (batch->n == 0) return;
+
+    // flush raylib's own batch first, so the draw order is kept
+    rlDrawRenderBatchActive();
+
+    Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+    set_uniform_mat4(batch->mvp, mvp);
+    set_uniform_float(batch->time, time);
+    rlEnableShader(batch->shader.id);
+
+    rlActiveTextureSlot(0);
+    rlEnableTexture(batch->texture.id);
+
+    rlEnableVertexArray(batch->vao);
+    rlUpdateVertexBuffer(
+        batch->instance_vbo, batch->instances, batch->n * sizeof(SpriteInstance), 0
+    );
+    rlDrawVertexArrayInstanced(0, 6, batch->n);
+    rlDisableVertexArray();
+
+    rlDisableTexture();
+    rlDisableShader();
+
+    batch->n = 0;
+}
+
+static void set_instance_attribute(
+    unsigned int shader_id, const char *name, int size, int type, size_t offset
+) {
+    int loc = rlGetLocationAttrib(shader_id, name);
+    if (loc < 0) return;
+
+    bool is_normalized = type == RL_UNSIGNED_BYTE;
+    rlSetVertexAttribute(
+        loc, size, type, is_normalized, sizeof(SpriteInstance), (void *)offset
+    );
+    rlSetVertexAttributeDivisor(loc, 1);
+    rlEnableVertexAttribute(loc);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "raylib.h"
+#include "shader.h"
+
+#define MAX_N_SPRITE_INSTANCES 16384
+
+// One sprite on the ground plane. The animation frame is picked by the
+// vertex shader from the batch time, so the cpu only fills this struct
+typedef struct SpriteInstance {
+    Vector4 position;   // xyz and the rotation around z (radians) in w
+    Vector4 region;     // of the whole strip in the atlas: x, y, frame width, height
+    Vector4 animation;  // n_frames, fps, start time, is_repeat
+    Color color;
+} SpriteInstance;
+
+// All sprites of a frame go into one instanced draw call:
+// a shared quad plus a dynamic buffer of SpriteInstance
+typedef struct SpriteBatch {
+    unsigned int vao;
+    unsigned int quad_vbo;
+    unsigned int instance_vbo;
+
+    Shader shader;
+    Texture2D texture;
+    UniformMat4 mvp;
+    UniformFloat time;
+
+    int n;
+    SpriteInstance instances[MAX_N_SPRITE_INSTANCES];
+} SpriteBatch;
+
+void init_sprite_batch(SpriteBatch *batch, Shader shader, Texture2D texture, float size);
+void unload_sprite_batch(SpriteBatch *batch);
+void push_sprite(SpriteBatch *batch, SpriteInstance instance);
+void draw_sprite_batch(SpriteBatch *batch, float time);
@@ -0,0 +1,250 @@
+#include "text_cache.h"
+
+#include "rlgl.h"
+#include <string.h>
+
+static uint64_t hash_text(unsigned int font_id, const char *text);
+static void layout_text_run(TextRun *run, Font font, const char *text);
+static void link_text_run(TextCache *cache, int idx);
+static void unlink_text_run(TextCache *cache, int idx);
+static void remove_text_run_slot(TextCache *cache, int idx);
+
+void init_text_cache(TextCache *cache) {
+    for (int i = 0; i < N_TEXT_RUN_SLOTS; ++i) cache->slots[i] = -1;
+    cache->first_run = -1;
+    cache->last_run = -1;
+    cache->n_runs = 0;
+    cache->n_quads = 0;
+}
+
+const TextRun *get_text_run(TextCache *cache, Font font, const char *text) {
+    unsigned int font_id = font.texture.id;
+    uint64_t hash = hash_text(font_id, text);
+
+    // linear probing, the table is at most half full
+    int mask = N_TEXT_RUN_SLOTS - 1;
+    int slot = hash & mask;
+    for (int idx; (idx = cache->slots[slot]) != -1; slot = (slot + 1) & mask) {
+        TextRun *run = &cache->runs[idx];
+        if (run->hash == hash && run->font_id == font_id
+            && strncmp(run->text, text, MAX_TEXT_RUN_LEN - 1) == 0) {
+            unlink_text_run(cache, idx);
+            link_text_run(cache, idx);
+            return run;
+        }
+    }
+
+    int idx = cache->n_runs;
+    if (idx < MAX_N_TEXT_RUNS) {
+        cache->n_runs += 1;
+    } else {
+        // the removal may shift the slots, so the free one is searched again
+        idx = cache->last_run;
+        unlink_text_run(cache, idx);
+        remove_text_run_slot(cache, idx);
+        slot = hash & mask;
+        while (cache->slots[slot] != -1) slot = (slot + 1) & mask;
+    }
+
+    TextRun *run = &cache->runs[idx];
+    run->hash = hash;
+    run->font_id = font_id;
+    layout_text_run(run, font, text);
+    cache->slots[slot] = idx;
+    link_text_run(cache, idx);
+
+    return run;
+}
+
+Vector2 measure_text(TextCache *cache, Font font, const char *text) {
+    return get_text_run(cache, font, text)->size;
+}
+
+// The first n_matched chars are green, the rest of the prompt_len ones red
+void push_text(
+    TextCache *cache,
+    Font font,
+    const char *text,
+    Vector2 position,
+    int n_matched,
+    int prompt_len
+) {
+    if (font.texture.id == 0) return;
+
+    const TextRun *run = get_text_run(cache, font, text);
+    if (cache->n_quads + run->n_quads > MAX_N_TEXT_QUADS) draw_text_batch(cache);
+
+    for (int i = 0; i < run->n_quads; ++i) {
+        int char_idx = run->char_idx[i];
+        Color color;
+        if (char_idx < n_matched) {
+            color = GREEN;
+        } else if (char_idx < prompt_len) {
+            color = RED;
+        } else {
+            color = WHITE;
+        }
+
+        Rectangle dst = run->dst[i];
+        dst.x += position.x;
+        dst.y += position.y;
+        cache->quads[cache->n_quads++] = (TextQuad){
+            font.texture.id, run->src[i], dst, color};
+    }
+}
+
+// A solid quad drawn with the white block of the font atlas (see decode_asset), so
+// it keeps its order with the text of the same font, in the same batch
+void push_rect(TextCache *cache, Font font, Rectangle dst, Color color) {
+    if (font.texture.id == 0) return;
+    if (cache->n_quads + 1 > MAX_N_TEXT_QUADS) draw_text_batch(cache);
+
+    // a point at the center of the block, every texel around it is white too
+    Rectangle src = {
+        (font.texture.width - 1.5f) / font.texture.width,
+        (font.texture.height - 1.5f) / font.texture.height,
+        0.0,
+        0.0};
+    cache->quads[cache->n_quads++] = (TextQuad){font.texture.id, src, dst, color};
+}
+
+// Emits the queued quads grouped by the font texture, so raylib's batch
+// draws each group at once, and empties the queue
+void draw_text_batch(TextCache *cache) {
+    int n_left = cache->n_quads;
+    while (n_left > 0) {
+        unsigned int texture_id = 0;
+        int n_quads = 0;
+        for (int i = 0; i < cache->n_quads; ++i) {
+            TextQuad *quad = &cache->quads[i];
+            if (quad->texture_id == 0) continue;
+            if (texture_id == 0) texture_id = quad->texture_id;
+            if (quad->texture_id == texture_id) n_quads += 1;
+        }
+
+        rlCheckRenderBatchLimit(4 * n_quads);
+        rlSetTexture(texture_id);
+        rlBegin(RL_QUADS);
+        rlNormal3f(0.0, 0.0, 1.0);
+        for (int i = 0; i < cache->n_quads; ++i) {
+            TextQuad *quad = &cache->quads[i];
+            if (quad->texture_id != texture_id) continue;
+
+            Rectangle s = quad->src;
+            Rectangle d = quad->dst;
+            rlColor4ub(quad->color.r, quad->color.g, quad->color.b, quad->color.a);
+
+            rlTexCoord2f(s.x, s.y);
+            rlVertex2f(d.x, d.y);
+            rlTexCoord2f(s.x, s.y + s.height);
+            rlVertex2f(d.x, d.y + d.height);
+            rlTexCoord2f(s.x + s.width, s.y + s.height);
+            rlVertex2f(d.x + d.width, d.y + d.height);
+            rlTexCoord2f(s.x + s.width, s.y);
+            rlVertex2f(d.x + d.width, d.y);
+
+            quad->texture_id = 0;
+        }
+        rlEnd();
+        rlSetTexture(0);
+
+        n_left -= n_quads;
+    }
+
+    cache->n_quads = 0;
+}
+
+static void link_text_run(TextCache *cache, int idx) {
+    TextRun *run = &cache->runs[idx];
+    run->prev = -1;
+    run->next = cache->first_run;
+    if (cache->first_run != -1) cache->runs[cache->first_run].prev = idx;
+    else cache->last_run = idx;
+    cache->first_run = idx;
+}
+
+static void unlink_text_run(TextCache *cache, int idx) {
+    TextRun *run = &cache->runs[idx];
+    if (run->prev != -1) cache->runs[run->prev].next = run->next;
+    else cache->first_run = run->next;
+    if (run->next != -1) cache->runs[run->next].prev = run->prev;
+    else cache->last_run = run->prev;
+}
+
+// Empties the slot of the run and shifts back the following ones which would
+// otherwise become unreachable from their home slots
+static void remove_text_run_slot(TextCache *cache, int idx) {
+    int mask = N_TEXT_RUN_SLOTS - 1;
+    int slot = cache->runs[idx].hash & mask;
+    while (cache->slots[slot] != idx) slot = (slot + 1) & mask;
+
+    int next = slot;
+    while (true) {
+        next = (next + 1) & mask;
+        int next_idx = cache->slots[next];
+        if (next_idx == -1) break;
+
+        // the run may move to the empty slot if that's not before its home one
+        int home = cache->runs[next_idx].hash & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            cache->slots[slot] = next_idx;
+            slot = next;
+        }
+    }
+    cache->slots[slot] = -1;
+}
+
+// FNV-1a over the font and the text
+static uint64_t hash_text(unsigned int font_id, const char *text) {
+    uint64_t hash = 14695981039346656037ULL ^ font_id;
+    hash *= 1099511628211ULL;
+    for (int i = 0; text[i] && i < MAX_TEXT_RUN_LEN - 1; ++i) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Same quads DrawTextCodepoint would draw and the same advances as before
+static void layout_text_run(TextRun *run, Font font, const char *text) {
+    strncpy(run->text, text, MAX_TEXT_RUN_LEN - 1);
+    run->text[MAX_TEXT_RUN_LEN - 1] = '\0';
+    run->n_quads = 0;
+
+    float offset = 0.0;
+    float width = 0.0;
+    float padding = font.glyphPadding;
+    float texture_width = font.texture.width;
+    float texture_height = font.texture.height;
+    for (int i = 0; run->text[i]; ++i) {
+        int ch = run->text[i];
+        int index = GetGlyphIndex(font, ch);
+        GlyphInfo glyph = font.glyphs[index];
+        Rectangle rec = font.recs[index];
+
+        if (ch != ' ') {
+            int k = run->n_quads++;
+            run->char_idx[k] = i;
+            run->src[k] = (Rectangle){
+                (rec.x - padding) / texture_width,
+                (rec.y - padding) / texture_height,
+                (rec.width + 2.0 * padding) / texture_width,
+                (rec.height + 2.0 * padding) / texture_height};
+            run->dst[k] = (Rectangle){
+                offset + glyph.offsetX - padding,
+                glyph.offsetY - padding,
+                rec.width + 2.0 * padding,
+                rec.height + 2.0 * padding};
+        }
+
+        if (glyph.advanceX == 0) {
+            offset += rec.width;
+            width += rec.width + glyph.offsetX;
+        } else {
+            offset += glyph.advanceX;
+            width += glyph.advanceX;
+        }
+    }
+
+    run->size = (Vector2){width, font.baseSize};
+}
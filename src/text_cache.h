@@ -0,0 +1,61 @@
+#pragma once
+
+#include "raylib.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_N_TEXT_RUNS 1024
+#define N_TEXT_RUN_SLOTS (2 * MAX_N_TEXT_RUNS)  // of the hash table, a power of two
+#define MAX_TEXT_RUN_LEN 64
+#define MAX_N_TEXT_QUADS 8192  // queued, push_text draws the queue when it's full
+
+// Laid out text: the glyph quads are measured once per (font, string),
+// drawing it again only copies them with the colors of the frame
+typedef struct TextRun {
+    int prev;  // more recently used run or -1
+    int next;  // less recently used run or -1
+    uint64_t hash;
+    unsigned int font_id;  // of the font texture
+    char text[MAX_TEXT_RUN_LEN];
+
+    Vector2 size;  // as MeasureTextEx with the base size and no spacing
+    int n_quads;   // spaces have no quads
+    Rectangle src[MAX_TEXT_RUN_LEN];  // normalized texture coordinates
+    Rectangle dst[MAX_TEXT_RUN_LEN];  // relative to the text position
+    unsigned char char_idx[MAX_TEXT_RUN_LEN];
+} TextRun;
+
+typedef struct TextQuad {
+    unsigned int texture_id;
+    Rectangle src;
+    Rectangle dst;
+    Color color;
+} TextQuad;
+
+// Text runs cache and the queue of glyph quads. The queue goes out in one
+// batch per font texture, instead of a draw call per character. Once all runs
+// are taken, a new text evicts the least recently used one
+typedef struct TextCache {
+    int slots[N_TEXT_RUN_SLOTS];  // run indices, -1 if empty
+    int first_run;                // most recently used
+    int last_run;                 // least recently used
+    int n_runs;
+    TextRun runs[MAX_N_TEXT_RUNS];
+
+    int n_quads;
+    TextQuad quads[MAX_N_TEXT_QUADS];
+} TextCache;
+
+void init_text_cache(TextCache *cache);
+const TextRun *get_text_run(TextCache *cache, Font font, const char *text);
+Vector2 measure_text(TextCache *cache, Font font, const char *text);
+void push_text(
+    TextCache *cache,
+    Font font,
+    const char *text,
+    Vector2 position,
+    int n_matched,
+    int prompt_len
+);
+void push_rect(TextCache *cache, Font font, Rectangle dst, Color color);
+void draw_text_batch(TextCache *cache);
@@ -0,0 +1,110 @@
+#include "voices.h"
+
+#include <stddef.h>
+
+static Voice *steal_voice(VoicePool *pool, Voice *voices, int n, float volume);
+
+// Returns the sample id, -1 if the pool is full (the sound is unloaded then)
+int add_voice_sample(VoicePool *pool, Sound sound) {
+    if (pool->n_samples == MAX_N_VOICE_SAMPLES) {
+        TraceLog(LOG_WARNING, "VOICES: Too many samples, max %d", MAX_N_VOICE_SAMPLES);
+        UnloadSound(sound);
+        return -1;
+    }
+
+    int sample = pool->n_samples++;
+    pool->samples[sample] = sound;
+    for (int i = 0; i < N_SAMPLE_VOICES; ++i) {
+        pool->voices[sample][i] = (Voice){.sound = LoadSoundAlias(sound)};
+    }
+    return sample;
+}
+
+void unload_voice_pool(VoicePool *pool) {
+    for (int s = 0; s < pool->n_samples; ++s) {
+        for (int i = 0; i < N_SAMPLE_VOICES; ++i) {
+            UnloadSoundAlias(pool->voices[s][i].sound);
+        }
+        UnloadSound(pool->samples[s]);
+    }
+    pool->n_samples = 0;
+    pool->n_playing = 0;
+}
+
+// Called once per tick, before the tick plays anything: frees finished voices
+void update_voice_pool(VoicePool *pool) {
+    pool->tick += 1;
+    if (pool->n_playing == 0) return;
+
+    pool->n_playing = 0;
+    for (int s = 0; s < pool->n_samples; ++s) {
+        for (int i = 0; i < N_SAMPLE_VOICES; ++i) {
+            Voice *voice = &pool->voices[s][i];
+            if (!voice->is_playing) continue;
+            voice->is_playing = IsSoundPlaying(voice->sound);
+            pool->n_playing += voice->is_playing;
+        }
+    }
+}
+
+void play_voice(VoicePool *pool, int sample, float volume, float pan) {
+    if (sample < 0 || sample >= pool->n_samples) return;
+    Voice *voices = pool->voices[sample];
+
+    // the same sample triggered again in this tick: one voice, the loudest one
+    Voice *free_voice = NULL;
+    for (int i = 0; i < N_SAMPLE_VOICES; ++i) {
+        Voice *voice = &voices[i];
+        if (voice->is_playing && voice->start_tick == pool->tick) {
+            if (volume > voice->volume) {
+                voice->volume = volume;
+                voice->pan = pan;
+                SetSoundVolume(voice->sound, volume);
+                SetSoundPan(voice->sound, pan);
+            }
+            return;
+        }
+        if (!voice->is_playing && !free_voice) free_voice = voice;
+    }
+
+    Voice *voice = free_voice;
+    if (!voice) {
+        // all aliases of the sample are busy: restart one of them
+        voice = steal_voice(pool, voices, N_SAMPLE_VOICES, volume);
+    } else if (pool->n_playing >= MAX_N_PLAYING_VOICES) {
+        // over the budget: make room by stopping a voice of any sample
+        int n_voices = pool->n_samples * N_SAMPLE_VOICES;
+        if (!steal_voice(pool, &pool->voices[0][0], n_voices, volume)) voice = NULL;
+    }
+    if (!voice) return;
+
+    if (!voice->is_playing) pool->n_playing += 1;
+    voice->volume = volume;
+    voice->pan = pan;
+    voice->start_tick = pool->tick;
+    voice->is_playing = true;
+    SetSoundVolume(voice->sound, volume);
+    SetSoundPan(voice->sound, pan);
+    PlaySound(voice->sound);
+}
+
+// Stops the quietest playing voice, the oldest one among equally quiet. Nothing is
+// stolen for a sound quieter than all of them
+static Voice *steal_voice(VoicePool *pool, Voice *voices, int n, float volume) {
+    Voice *victim = NULL;
+    for (int i = 0; i < n; ++i) {
+        Voice *voice = &voices[i];
+        if (!voice->is_playing) continue;
+        if (!victim || voice->volume < victim->volume
+            || (voice->volume == victim->volume
+                && voice->start_tick < victim->start_tick)) {
+            victim = voice;
+        }
+    }
+    if (!victim || victim->volume > volume) return NULL;
+
+    StopSound(victim->sound);
+    victim->is_playing = false;
+    pool->n_playing -= 1;
+    return victim;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "raylib.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_N_VOICE_SAMPLES 128
+#define N_SAMPLE_VOICES 4         // aliases of one sample: its own polyphony
+#define MAX_N_PLAYING_VOICES 24  // of all samples together
+
+typedef struct Voice {
+    Sound sound;  // alias of the sample, shares its decoded buffer
+    float volume;
+    float pan;  // 0 is left, 1 is right
+    uint32_t start_tick;
+    bool is_playing;
+} Voice;
+
+// Fixed set of sound aliases with a polyphony budget. Triggers of one sample in
+// the same tick are merged into one voice, a new voice over the budget steals
+// the quietest (then the oldest) playing one, so the mixer never has more than
+// MAX_N_PLAYING_VOICES buffers to mix no matter how many events fire
+typedef struct VoicePool {
+    int n_samples;
+    Sound samples[MAX_N_VOICE_SAMPLES];
+    Voice voices[MAX_N_VOICE_SAMPLES][N_SAMPLE_VOICES];
+
+    int n_playing;
+    uint32_t tick;
+} VoicePool;
+
+int add_voice_sample(VoicePool *pool, Sound sound);
+void unload_voice_pool(VoicePool *pool);
+void update_voice_pool(VoicePool *pool);
+void play_voice(VoicePool *pool, int sample, float volume, float pan);
@@ -0,0 +1,138 @@
+#include "words.h"
+
+#include "raylib.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(PLATFORM_WEB)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static bool load_data(Words *words, const char *file_path);
+static bool build_index(Words *words, int max_len);
+
+bool load_words(Words *words, const char *file_path, int max_len) {
+    memset(words, 0, sizeof(Words));
+
+    if (!load_data(words, file_path)) {
+        TraceLog(LOG_WARNING, "WORDS: Failed to load %s", file_path);
+        return false;
+    }
+
+    if (!build_index(words, max_len)) {
+        TraceLog(LOG_WARNING, "WORDS: Failed to index %s", file_path);
+        unload_words(words);
+        return false;
+    }
+
+    TraceLog(LOG_INFO, "WORDS: Loaded %d words from %s", words->n, file_path);
+    return true;
+}
+
+bool load_words_from_memory(Words *words, const char *data, int size, int max_len) {
+    memset(words, 0, sizeof(Words));
+    words->data = (char *)data;
+    words->size = size;
+    words->is_borrowed = true;
+
+    if (!build_index(words, max_len)) {
+        TraceLog(LOG_WARNING, "WORDS: Failed to index words in memory");
+        unload_words(words);
+        return false;
+    }
+
+    return true;
+}
+
+void unload_words(Words *words) {
+#if !defined(PLATFORM_WEB)
+    if (words->is_mapped) munmap(words->data, words->size);
+#endif
+    if (!words->is_mapped && !words->is_borrowed) {
+        UnloadFileData((unsigned char *)words->data);
+    }
+
+    free(words->offsets);
+    free(words->lens);
+    memset(words, 0, sizeof(Words));
+}
+
+WordView get_word(const Words *words, int idx) {
+    return (WordView){words->data + words->offsets[idx], words->lens[idx]};
+}
+
+static bool load_data(Words *words, const char *file_path) {
+#if !defined(PLATFORM_WEB)
+    int fd = open(file_path, O_RDONLY);
+    if (fd == -1) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return false;
+    }
+
+    // an empty file can't be mapped, but it's still a valid (empty) list
+    words->size = st.st_size;
+    if (words->size > 0) {
+        void *data = mmap(NULL, words->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        madvise(data, words->size, MADV_SEQUENTIAL);
+        words->data = data;
+        words->is_mapped = true;
+    }
+    close(fd);
+
+    return true;
+#else
+    // there is no mmap in the browser, the preloaded file is read into memory
+    words->data = (char *)LoadFileData(file_path, &words->size);
+    return words->data != NULL;
+#endif
+}
+
+static bool build_index(Words *words, int max_len) {
+    int capacity = words->size / 8 + 16;
+    words->offsets = malloc(capacity * sizeof(int));
+    words->lens = malloc(capacity);
+    if (!words->offsets || !words->lens) return false;
+
+    const char *data = words->data;
+    int offset = 0;
+    while (offset < words->size) {
+        const char *end = memchr(data + offset, '\n', words->size - offset);
+        int line_len = end ? end - (data + offset) : words->size - offset;
+
+        int len = line_len;
+        if (len > 0 && data[offset + len - 1] == '\r') len -= 1;
+
+        // names which don't fit the fixed-size name buffers are skipped
+        // instead of being split into several words
+        if (len > 0 && len <= max_len) {
+            if (words->n == capacity) {
+                capacity *= 2;
+                int *offsets = realloc(words->offsets, capacity * sizeof(int));
+                if (!offsets) return false;
+                words->offsets = offsets;
+
+                unsigned char *lens = realloc(words->lens, capacity);
+                if (!lens) return false;
+                words->lens = lens;
+            }
+
+            words->offsets[words->n] = offset;
+            words->lens[words->n] = len;
+            words->n += 1;
+        }
+
+        offset += line_len + 1;
+    }
+
+    return true;
+}
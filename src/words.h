@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+
+// View into the text of a word list, it's not null-terminated
+typedef struct WordView {
+    const char *str;
+    int len;
+} WordView;
+
+// Word list (one word per line) indexed by the offsets of the words in its text.
+// On desktop the file is memory-mapped, so loading is a single pass over the
+// text and the memory is proportional to the text itself
+typedef struct Words {
+    int n;
+    int *offsets;
+    unsigned char *lens;
+
+    char *data;
+    int size;
+    bool is_mapped;
+    bool is_borrowed;  // the text is owned by the caller (e.g. it's in a pack)
+} Words;
+
+bool load_words(Words *words, const char *file_path, int max_len);
+bool load_words_from_memory(Words *words, const char *data, int size, int max_len);
+void unload_words(Words *words);
+WordView get_word(const Words *words, int idx);